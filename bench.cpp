@@ -0,0 +1,451 @@
+#include "step_tracker.h"
+#include <random>
+#include <numeric> // For std::iota
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h> // For getrusage (peak RSS)
+#endif
+
+// Benchmark harness: generates a synthetic population at each requested scale, loads it,
+// and times every public StepTrackerApp operation. Results are written to stdout as JSON
+// lines (one object per scale and operation) so they can be collected and compared over
+// time; progress messages go to stderr.
+//
+//   ./step_tracker_bench --scales=1000,100000,10000000 --group-sizes=uniform --days=7
+
+// --- Synthetic Data Generation ---
+
+enum class GroupSizes { Fixed, Uniform, Skewed };
+
+struct SyntheticSpec {
+    size_t individuals = 1000;
+    size_t groups = 250;
+    size_t days = 7;                        // Step entries per individual (the app keeps the latest 7)
+    GroupSizes group_sizes = GroupSizes::Uniform; // Uniform: 1..MAX_MEMBERS; Skewed: P(k) ~ 1/k
+    int fixed_group_size = Group::MAX_MEMBERS;    // Size of every group for GroupSizes::Fixed
+    uint32_t seed = 42;
+};
+
+// Appends an int to a line buffer without going through iostreams.
+void append_int(string& line, long long value) {
+    char digits[24];
+    auto result = to_chars(digits, digits + sizeof(digits), value);
+    line.append(digits, result.ptr);
+}
+
+// Writes individuals and groups CSV files for the spec. Every individual belongs to at
+// most one group; generation stops early if the population runs out of members.
+// Returns the number of groups written, or nullopt if a file could not be written.
+optional<size_t> generate_synthetic_csv(const SyntheticSpec& spec, const string& individuals_file,
+                                        const string& groups_file) {
+    mt19937 rng(spec.seed);
+    ofstream ind_csv(individuals_file, ios::binary);
+    ofstream grp_csv(groups_file, ios::binary);
+    if (!ind_csv.is_open() || !grp_csv.is_open()) {
+        cerr << "Error: Could not create benchmark CSV files '" << individuals_file << "' and '" << groups_file << "'" << endl;
+        return nullopt;
+    }
+
+    string line;
+    ind_csv << INDIVIDUALS_CSV_HEADER << "\n";
+    for (size_t i = 1; i <= spec.individuals; ++i) {
+        int goal = 4000 + static_cast<int>(rng() % 8000);
+        line.clear();
+        append_int(line, static_cast<long long>(i));
+        line += ",Person ";
+        append_int(line, static_cast<long long>(i));
+        line += ',';
+        append_int(line, 18 + rng() % 60);
+        line += ',';
+        append_int(line, goal);
+        line += ",0";
+        for (size_t day = 0; day < spec.days; ++day) {
+            line += ',';
+            append_int(line, goal / 2 + static_cast<int>(rng() % static_cast<uint32_t>(goal))); // 50%..150% of the goal
+        }
+        line += '\n';
+        ind_csv.write(line.data(), static_cast<streamsize>(line.size()));
+    }
+
+    // Members are dealt from a shuffled ID sequence so groups are scattered over the ID space
+    vector<int> ids(spec.individuals);
+    iota(ids.begin(), ids.end(), 1);
+    shuffle(ids.begin(), ids.end(), rng);
+    double harmonic = 0;
+    for (int k = 1; k <= Group::MAX_MEMBERS; ++k) harmonic += 1.0 / k;
+    uniform_real_distribution<double> unit(0.0, 1.0);
+
+    grp_csv << GROUPS_CSV_HEADER << "\n";
+    size_t next_member = 0, written = 0;
+    for (size_t g = 0; g < spec.groups && next_member < ids.size(); ++g) {
+        size_t size = 1;
+        if (spec.group_sizes == GroupSizes::Fixed) {
+            size = static_cast<size_t>(clamp(spec.fixed_group_size, 1, Group::MAX_MEMBERS));
+        } else if (spec.group_sizes == GroupSizes::Uniform) {
+            size = 1 + rng() % Group::MAX_MEMBERS;
+        } else {
+            double pick = unit(rng) * harmonic;
+            for (int k = 1; k <= Group::MAX_MEMBERS; ++k, ++size) {
+                pick -= 1.0 / k;
+                if (pick <= 0 || k == Group::MAX_MEMBERS) break;
+            }
+        }
+        size = min(size, ids.size() - next_member);
+        line = "G";
+        append_int(line, static_cast<long long>(g));
+        line += ",Group ";
+        append_int(line, static_cast<long long>(g));
+        line += ',';
+        for (size_t m = 0; m < size; ++m) {
+            if (m > 0) line += ';';
+            append_int(line, ids[next_member++]);
+        }
+        line += ',';
+        append_int(line, static_cast<long long>(size) * 7 * 8000);
+        line += '\n';
+        grp_csv.write(line.data(), static_cast<streamsize>(line.size()));
+        ++written;
+    }
+
+    ind_csv.close();
+    grp_csv.close();
+    if (!ind_csv || !grp_csv) {
+        cerr << "Error: Could not write benchmark CSV files." << endl;
+        return nullopt;
+    }
+    return written;
+}
+
+// --- Measurement ---
+
+// Peak resident set size of the process so far, in KiB (0 where unsupported).
+long peak_rss_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024; // Reported in bytes
+#else
+    return usage.ru_maxrss;        // Reported in KiB
+#endif
+#else
+    return 0;
+#endif
+}
+
+struct OpTiming {
+    string op;
+    vector<double> latencies_us; // One entry per call
+    double total_seconds = 0;
+};
+
+// Calls fn(i) for i in [0, iterations) and records the latency of every call.
+template <typename Fn>
+OpTiming time_op(const string& op, size_t iterations, Fn&& fn) {
+    OpTiming timing;
+    timing.op = op;
+    timing.latencies_us.reserve(iterations);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        auto call_start = chrono::steady_clock::now();
+        fn(i);
+        timing.latencies_us.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - call_start).count());
+    }
+    timing.total_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return timing;
+}
+
+double percentile(vector<double> values, double fraction) {
+    if (values.empty()) return 0;
+    size_t index = min(values.size() - 1, static_cast<size_t>(fraction * static_cast<double>(values.size())));
+    nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(index), values.end());
+    return values[index];
+}
+
+// Appends allocation counters as a JSON object member.
+void append_allocations(string& line, const char* name, const AllocationStats& stats) {
+    char member[192];
+    snprintf(member, sizeof(member),
+             ",\"%s\":{\"allocations\":%zu,\"deallocations\":%zu,\"bytes_in_use\":%zu,\"peak_bytes\":%zu}", name,
+             stats.allocations, stats.deallocations, stats.bytes_in_use, stats.peak_bytes);
+    line += member;
+}
+
+// Prints one result as a JSON line, with the app's allocation counters after the op
+// (cumulative since the app was loaded).
+void report(const SyntheticSpec& spec, size_t groups, unsigned threads, const OpTiming& timing,
+            const MemoryStats& memory) {
+    size_t calls = timing.latencies_us.size();
+    double max_us = calls ? *max_element(timing.latencies_us.begin(), timing.latencies_us.end()) : 0;
+    char fields[512];
+    snprintf(fields, sizeof(fields),
+             "{\"benchmark\":\"step_tracker\",\"scale\":%zu,\"groups\":%zu,\"days\":%zu,\"threads\":%u,"
+             "\"op\":\"%s\",\"iterations\":%zu,\"total_ms\":%.3f,\"throughput_ops_s\":%.1f,"
+             "\"p50_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f,\"peak_rss_kb\":%ld",
+             spec.individuals, groups, spec.days, threads, timing.op.c_str(), calls, timing.total_seconds * 1e3,
+             timing.total_seconds > 0 ? static_cast<double>(calls) / timing.total_seconds : 0.0,
+             percentile(timing.latencies_us, 0.50), percentile(timing.latencies_us, 0.99), max_us, peak_rss_kb());
+    string line = fields;
+    append_allocations(line, "tree_nodes", memory.tree_nodes);
+    append_allocations(line, "scratch", memory.scratch);
+    line += '}';
+    cout << line << endl;
+}
+
+// --- Benchmark Driver ---
+
+struct BenchOptions {
+    vector<size_t> scales{1000, 100000, 10000000};
+    double groups_per_individual = 0.25;
+    SyntheticSpec spec;
+    size_t iterations = 1000;      // Calls of each point operation
+    size_t report_iterations = 10; // Calls of the whole-population reports
+    size_t io_iterations = 3;      // Loads and saves
+    vector<unsigned> thread_counts{0}; // Task pool sizes swept by the parallel reports; 0 = one per core
+    string file_prefix = "bench_";
+};
+
+// Runs every operation at one scale and reports each as it finishes.
+bool run_scale(const BenchOptions& options, size_t scale) {
+    SyntheticSpec spec = options.spec;
+    spec.individuals = scale;
+    spec.groups = max<size_t>(1, static_cast<size_t>(static_cast<double>(scale) * options.groups_per_individual));
+    string individuals_file = options.file_prefix + "individuals.csv";
+    string groups_file = options.file_prefix + "groups.csv";
+    string journal_file = options.file_prefix + "step_tracker.journal";
+    string snapshot_file = options.file_prefix + "step_tracker.snapshot";
+
+    cerr << "Generating " << scale << " individuals..." << endl;
+    optional<size_t> groups = generate_synthetic_csv(spec, individuals_file, groups_file);
+    if (!groups) return false;
+
+    // Compaction is timed on its own (save_snapshot), so keep it out of the mutator timings
+    JournalPolicy policy;
+    policy.compact_after_records = SIZE_MAX;
+    unique_ptr<StepTrackerApp> app;
+    auto open_app = [&]() {
+        app.reset(); // Release the previous instance before loading the next one
+        streambuf* stdout_buffer = cout.rdbuf(cerr.rdbuf()); // Load messages are progress, not results
+        app = make_unique<StepTrackerApp>(individuals_file, groups_file, journal_file, policy, snapshot_file);
+        cout.rdbuf(stdout_buffer);
+        app->set_output_format(OutputFormat::Quiet);
+        app->set_thread_count(options.thread_counts.front()); // Serial ops and loads run at the first count
+    };
+    auto emit = [&](const OpTiming& timing) {
+        if (timing.latencies_us.empty()) return; // Too few iterations to run the op at all; not a measurement
+        report(spec, *groups, app->thread_count(), timing, app->allocation_stats());
+    };
+
+    cerr << "Timing loads and saves..." << endl;
+    OpTiming load_csv = time_op("load_csv", options.io_iterations, [&](size_t) {
+        remove(snapshot_file.c_str()); // Forces the CSV import path (which also writes the snapshot)
+        remove(journal_file.c_str());
+        open_app();
+    });
+    emit(load_csv);
+    // Opening a snapshot only maps it; lookups read the mapped records until the first
+    // mutation or whole-population report builds the trees
+    emit(time_op("load_snapshot", options.io_iterations, [&](size_t) { open_app(); }));
+    mt19937 lookup_rng(spec.seed + 2);
+    emit(time_op("export_individual_mapped", options.iterations, [&](size_t) {
+        app->export_individual(1 + static_cast<int>(lookup_rng() % scale));
+    }));
+    emit(time_op("build_from_snapshot", options.io_iterations, [&](size_t) {
+        open_app();
+        app->get_individuals_tree();
+    }));
+    emit(time_op("save_snapshot", options.io_iterations, [&](size_t) { app->compact(); }));
+    emit(time_op("export_csv", options.io_iterations, [&](size_t) { app->export_csv(); }));
+
+    cerr << "Timing operations..." << endl;
+    mt19937 rng(spec.seed + 1);
+    int first_new_id = static_cast<int>(scale) + 1;
+    vector<int> week(spec.days);
+    emit(time_op("add_person", options.iterations, [&](size_t i) {
+        for (int& steps : week) steps = 3000 + static_cast<int>(rng() % 10000);
+        app->add_person(first_new_id + static_cast<int>(i), "Bench Person", 30, 8000, week);
+    }));
+    // Pairs of the people just added form new two-member groups, and pairs of those are merged
+    size_t new_groups = options.iterations / 2;
+    emit(time_op("create_group", new_groups, [&](size_t i) {
+        int member = first_new_id + static_cast<int>(2 * i);
+        app->create_group("B" + to_string(i), "Bench Group", {member, member + 1}, 50000);
+    }));
+    // The first half of the pairs one call each, the rest in batches of up to 50 (at least
+    // four batches while there are enough pairs, so small runs still time several calls)
+    size_t pairs = new_groups / 2, single_merges = pairs / 2;
+    size_t batched_pairs = pairs - single_merges;
+    size_t merge_batch = min<size_t>(50, max<size_t>(1, batched_pairs / 4));
+    emit(time_op("merge_groups", single_merges, [&](size_t i) {
+        app->merge_groups("B" + to_string(2 * i), "B" + to_string(2 * i + 1), "Merged Bench Group", 90000);
+    }));
+    vector<GroupMerge> merges;
+    emit(time_op("merge_groups_many", batched_pairs / merge_batch, [&](size_t batch) {
+        merges.clear();
+        for (size_t i = single_merges + batch * merge_batch; i < single_merges + (batch + 1) * merge_batch; ++i) {
+            merges.push_back({"B" + to_string(2 * i), "B" + to_string(2 * i + 1), "Merged Bench Group", 90000});
+        }
+        app->merge_groups_many(merges);
+    }));
+
+    // Device reports for today on random individuals, one call each and in batches of 1000
+    int today = app->current_day();
+    emit(time_op("record_steps", options.iterations, [&](size_t) {
+        app->record_steps(1 + static_cast<int>(rng() % scale), today, static_cast<int>(rng() % 20000));
+    }));
+    vector<StepRecord> reports(1000);
+    emit(time_op("record_steps_batch", options.report_iterations, [&](size_t) {
+        for (StepRecord& report : reports) report = {1 + static_cast<int>(rng() % scale), today, static_cast<int>(rng() % 20000)};
+        app->record_steps_batch(reports);
+    }));
+    emit(time_op("get_top_3", options.iterations, [&](size_t) { app->get_top_3(); }));
+    emit(time_op("generate_leader_board", options.report_iterations, [&](size_t) { app->generate_leader_board(); }));
+    // Repeats are served from the query cache until the next mutation; time the computation too
+    app->set_query_cache_capacity(0);
+    emit(time_op("generate_leader_board_uncached", options.report_iterations,
+                 [&](size_t) { app->generate_leader_board(); }));
+    app->set_query_cache_capacity(QueryCache::DEFAULT_CAPACITY_ROWS);
+
+    // Ranges of 10 consecutive groups in tree order
+    vector<string> group_ids;
+    group_ids.reserve(app->get_groups_tree().size());
+    for (const Group& group : app->get_groups_tree()) group_ids.push_back(group.group_id);
+    emit(time_op("display_group_range_info", options.iterations, [&](size_t) {
+        size_t start = rng() % group_ids.size();
+        size_t end = min(group_ids.size() - 1, start + 9);
+        app->display_group_range_info(group_ids[start], group_ids[end]);
+    }));
+    emit(time_op("suggest_goal_update", options.iterations, [&](size_t) {
+        app->suggest_goal_update(1 + static_cast<int>(rng() % scale));
+    }));
+    emit(time_op("step_history", options.iterations, [&](size_t) {
+        app->step_history(1 + static_cast<int>(rng() % scale), today - 89, today);
+    }));
+    // The reports that run on the task pool, once per thread count
+    vector<GoalSuggestion> suggestions;
+    for (unsigned thread_count : options.thread_counts) {
+        app->set_thread_count(thread_count);
+        emit(time_op("suggest_goal_updates_for_all", options.report_iterations,
+                     [&](size_t) { app->suggest_goal_updates_for_all(suggestions); }));
+        emit(time_op("population_summary", options.report_iterations, [&](size_t) { app->population_summary(); }));
+        emit(time_op("analyze_all_individuals", options.report_iterations,
+                     [&](size_t) { app->analyze_all_individuals(); }));
+    }
+    app->set_thread_count(options.thread_counts.front());
+    // Last, since each rollover zeroes today for everyone
+    emit(time_op("advance_to_day", options.report_iterations,
+                 [&](size_t i) { app->advance_to_day(today + 1 + static_cast<int>(i)); }));
+
+    // Built with -DSTEP_TRACKER_STATS: the app's own counters, accumulated over the run so far
+    StatsSnapshot stats = app->stats();
+    if (stats.enabled) {
+        cout << "{\"benchmark\":\"step_tracker\",\"scale\":" << spec.individuals
+             << ",\"stats\":" << format_stats_json(stats) << "}" << endl;
+    }
+
+    app.reset();
+    for (const string& file : {individuals_file, groups_file, journal_file, snapshot_file}) remove(file.c_str());
+    return true;
+}
+
+// Parses a comma-separated list of thread counts (0 = one per core).
+bool parse_thread_counts(const string& text, vector<unsigned>& thread_counts) {
+    thread_counts.clear();
+    stringstream list(text);
+    string item;
+    while (getline(list, item, ',')) {
+        int count = 0;
+        if (!parse_csv_int(item, count) || count < 0) return false;
+        thread_counts.push_back(static_cast<unsigned>(count));
+    }
+    return !thread_counts.empty();
+}
+
+// Parses a comma-separated list of positive counts (scientific notation such as 1e5 allowed).
+bool parse_scales(const string& text, vector<size_t>& scales) {
+    scales.clear();
+    stringstream list(text);
+    string item;
+    while (getline(list, item, ',')) {
+        char* end = nullptr;
+        double value = strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || value < 1) return false;
+        scales.push_back(static_cast<size_t>(value));
+    }
+    return !scales.empty();
+}
+
+void print_usage() {
+    cerr << "Usage: step_tracker_bench [options]\n"
+            "  --scales=N,N,...        Population sizes to run (default 1000,100000,10000000)\n"
+            "  --groups-per-individual=R  Groups generated per individual (default 0.25)\n"
+            "  --days=D                Step entries per individual (default 7)\n"
+            "  --group-sizes=uniform|skewed|fixed:K  Group size distribution (default uniform)\n"
+            "  --iterations=N          Calls of each point operation (default 1000)\n"
+            "  --report-iterations=N   Calls of each whole-population report (default 10)\n"
+            "  --io-iterations=N       Loads and saves per scale (default 3)\n"
+            "  --threads=N,N,...       Task pool threads; the parallel reports run once per count and\n"
+            "                          everything else at the first (default: one per core; 0 = one per core)\n"
+            "  --seed=S                Generator seed (default 42)\n"
+            "  --prefix=P              Prefix of the generated files (default bench_)\n";
+}
+
+bool parse_options(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == string::npos) return false;
+        string key = arg.substr(2, eq - 2), value = arg.substr(eq + 1);
+        int number = 0;
+        bool numeric = parse_csv_int(value, number) && number >= 0;
+        if (key == "scales") {
+            if (!parse_scales(value, options.scales)) return false;
+        } else if (key == "groups-per-individual") {
+            options.groups_per_individual = atof(value.c_str());
+            if (options.groups_per_individual <= 0) return false;
+        } else if (key == "days" && numeric && number > 0) {
+            options.spec.days = static_cast<size_t>(number);
+        } else if (key == "group-sizes") {
+            if (value == "uniform") {
+                options.spec.group_sizes = GroupSizes::Uniform;
+            } else if (value == "skewed") {
+                options.spec.group_sizes = GroupSizes::Skewed;
+            } else if (value.rfind("fixed:", 0) == 0 && parse_csv_int(value.substr(6), number) &&
+                       number >= 1 && number <= Group::MAX_MEMBERS) {
+                options.spec.group_sizes = GroupSizes::Fixed;
+                options.spec.fixed_group_size = number;
+            } else {
+                return false;
+            }
+        } else if (key == "iterations" && numeric && number > 0) {
+            options.iterations = static_cast<size_t>(number);
+        } else if (key == "report-iterations" && numeric && number > 0) {
+            options.report_iterations = static_cast<size_t>(number);
+        } else if (key == "io-iterations" && numeric && number > 0) {
+            options.io_iterations = static_cast<size_t>(number);
+        } else if (key == "threads") {
+            if (!parse_thread_counts(value, options.thread_counts)) return false;
+        } else if (key == "seed" && numeric) {
+            options.spec.seed = static_cast<uint32_t>(number);
+        } else if (key == "prefix") {
+            options.file_prefix = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+    // Scales run smallest first, so each scale's peak RSS is its own (it never shrinks)
+    sort(options.scales.begin(), options.scales.end());
+    for (size_t scale : options.scales) {
+        if (!run_scale(options, scale)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,6116 @@
+// Step tracker library: data models, B+ tree, storage, persistence and StepTrackerApp.
+// Included by the demo (main.cpp) and the benchmark (bench.cpp).
+#ifndef STEP_TRACKER_H
+#define STEP_TRACKER_H
+
+#include <iostream>
+#include <cstdint>    // For fixed-width integer types
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm> // For std::sort, std::remove, std::unique, std::lower_bound
+#include <set>       // For unique member IDs in merge_groups
+#include <unordered_map> // For the top-K rank cache
+#include <functional> // For std::function
+#include <memory>     // For std::unique_ptr (B+ tree nodes)
+#include <memory_resource> // For the node pools and per-query scratch arenas
+#include <array>      // For inline group member lists
+#include <iterator>   // For std::back_inserter, iterator tags
+#include <type_traits> // For std::conditional_t
+#include <chrono>     // For journal group-commit intervals
+#include <string_view> // For zero-copy CSV tokenizing
+#include <charconv>   // For std::from_chars
+#include <optional>   // For parse results
+#include <cstring>    // For memchr, memmove
+#include <cstdio>     // For snprintf in the report renderer
+#include <thread>     // For the task pool's workers
+#include <mutex>      // For std::mutex, std::unique_lock
+#include <condition_variable> // For waking idle pool workers
+#include <deque>      // For the pool's per-worker task queues
+#include <shared_mutex> // For the app's reader-writer lock
+#include <atomic>     // For the top-K cache flag and pool job counters
+#include <list>       // For the query cache's recency order
+#include <variant>    // For the query cache's result types
+
+// Use the entire std namespace for brevity
+using namespace std;
+
+// --- Data Models ---
+// Records are kept compact because the trees hold millions of them: names are views into
+// the app's StringArena, an individual's group is a 32-bit handle from GroupIdInterner,
+// step history lives in the app's StepStore, and a group's members are stored inline.
+
+using GroupHandle = uint32_t;           // Interned Group ID; see GroupIdInterner
+constexpr GroupHandle NO_GROUP = 0;     // Handle of "no group"
+
+// Group IDs such as "G7" or "Team12" are a text prefix followed by a number. A GroupKey
+// splits an ID once into the two, so IDs sort naturally (G2 < G10, and a range G1..G3 no
+// longer takes in G10..G29) and most comparisons are two integer compares: the first 8
+// bytes of the prefix are packed big-endian into one integer, and the trailing number
+// is another. The rest of a longer prefix, and then the whole ID (leading zeros, as in
+// G01 vs G1, or numbers too long to fit), break the remaining ties.
+// The key views its ID. Keys stored in the trees view the interned copy held by
+// GroupIdInterner; keys converted from a string argument are only meant for lookups.
+struct GroupKey {
+    uint64_t prefix = 0;        // First 8 bytes of the text before the trailing digits, zero padded
+    uint64_t number = 0;        // Trailing number + 1, or 0 if the ID does not end in a digit
+    uint32_t prefix_length = 0;
+    string_view id;
+
+    GroupKey() = default;
+    GroupKey(string_view group_id) : prefix_length(0), id(group_id) {
+        size_t digits = group_id.size();
+        while (digits > 0 && group_id[digits - 1] >= '0' && group_id[digits - 1] <= '9') --digits;
+        prefix_length = static_cast<uint32_t>(digits);
+        if (digits < group_id.size()) {
+            constexpr uint64_t LIMIT = UINT64_MAX / 10 - 1; // Longer numbers saturate
+            uint64_t value = 0;
+            for (size_t i = digits; i < group_id.size(); ++i) {
+                value = value >= LIMIT ? LIMIT : value * 10 + static_cast<uint64_t>(group_id[i] - '0');
+            }
+            number = value + 1;
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            prefix = (prefix << 8) | (i < digits ? static_cast<unsigned char>(group_id[i]) : 0u);
+        }
+    }
+    GroupKey(const string& group_id) : GroupKey(string_view(group_id)) {}
+    GroupKey(const char* group_id) : GroupKey(string_view(group_id)) {}
+
+    bool operator<(const GroupKey& other) const {
+        if (prefix != other.prefix) return prefix < other.prefix;
+        if (prefix_length > 8 || other.prefix_length > 8) {
+            int order = id.substr(0, prefix_length).compare(other.id.substr(0, other.prefix_length));
+            if (order != 0) return order < 0;
+        }
+        if (number != other.number) return number < other.number;
+        return id < other.id;
+    }
+    bool operator==(const GroupKey& other) const { return id == other.id; }
+    bool operator!=(const GroupKey& other) const { return id != other.id; }
+};
+
+class Individual {
+public:
+    int id;
+    int age;
+    int daily_step_goal;
+    int points; // Rewards points
+    uint32_t step_slot = UINT32_MAX; // Row of this individual's steps in the app's StepStore
+    GroupHandle group = NO_GROUP;    // Group they belong to, or NO_GROUP if none
+    string_view name;                // Stored in the app's StringArena
+
+    // Constructor to initialize an Individual object
+    Individual(int id, string_view name, int age, int daily_step_goal)
+        : id(id), age(age), daily_step_goal(daily_step_goal), points(0), name(name) {}
+
+    // Method to convert Individual object to a string for printing/debugging, given the
+    // step history and group ID the app stores for it
+    string toString(const int32_t* weekly_steps, size_t days, string_view group_id) const {
+        stringstream ss;
+        ss << "Individual(ID=" << id << ", Name=" << name << ", Age=" << age
+           << ", DailyGoal=" << daily_step_goal << ", WeeklySteps=[";
+        for (size_t i = 0; i < days; ++i) {
+            ss << weekly_steps[i] << (i == days - 1 ? "" : ",");
+        }
+        ss << "], Group=" << (group_id.empty() ? "None" : group_id)
+           << ", Points=" << points << ")";
+        return ss.str();
+    }
+};
+
+// Fixed-capacity list of IDs stored inline, with the vector operations groups need.
+template <size_t Capacity>
+class InlineIdList {
+private:
+    array<int, Capacity> ids{};
+    uint8_t count = 0;
+    static_assert(Capacity <= UINT8_MAX, "count is stored in one byte");
+
+public:
+    InlineIdList() = default;
+
+    static constexpr size_t capacity() { return Capacity; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int operator[](size_t i) const { return ids[i]; }
+
+    int* begin() { return ids.data(); }
+    int* end() { return ids.data() + count; }
+    const int* begin() const { return ids.data(); }
+    const int* end() const { return ids.data() + count; }
+
+    // Returns false if the list is full.
+    bool push_back(int id) {
+        if (count == Capacity) return false;
+        ids[count++] = id;
+        return true;
+    }
+
+    int* erase(int* first, int* last) {
+        int* new_end = move(last, end(), first);
+        count = static_cast<uint8_t>(new_end - begin());
+        return first;
+    }
+
+    void clear() { count = 0; }
+};
+
+class Group {
+public:
+    static constexpr int MAX_MEMBERS = 5; // Maximum number of members allowed in a group
+    using MemberList = InlineIdList<MAX_MEMBERS>;
+
+    string group_id; // This is the key for Group objects
+    string_view group_name; // Stored in the app's StringArena
+    MemberList member_ids;  // Sorted, unique
+    int weekly_group_goal;
+    GroupHandle handle = NO_GROUP; // Interned group_id, as stored in its members' records
+    GroupKey key;                  // Tree key, set from the interned group_id along with handle
+    long long total_weekly_steps; // Sum of members' weekly steps, maintained by StepTrackerApp on every mutation
+
+    // Constructor to initialize a Group object. Members beyond MAX_MEMBERS are dropped;
+    // callers validate the count first.
+    Group(string group_id, string_view group_name, vector<int> members, int weekly_group_goal)
+        : group_id(std::move(group_id)), group_name(group_name), weekly_group_goal(weekly_group_goal),
+          total_weekly_steps(0) {
+        // Ensure unique members on construction by sorting and removing duplicates
+        sort(members.begin(), members.end());
+        members.erase(unique(members.begin(), members.end()), members.end());
+        for (int member_id : members) {
+            if (!member_ids.push_back(member_id)) break;
+        }
+    }
+
+    // Method to convert Group object to a string for printing/debugging
+    string toString() const {
+        stringstream ss;
+        ss << "Group(ID=" << group_id << ", Name=" << group_name
+           << ", Members=[";
+        for (size_t i = 0; i < member_ids.size(); ++i) {
+            ss << member_ids[i] << (i == member_ids.size() - 1 ? "" : ",");
+        }
+        ss << "], Goal=" << weekly_group_goal
+           << ", TotalSteps=" << total_weekly_steps << ")";
+        return ss.str();
+    }
+};
+
+// --- String Arena and Group ID Interning ---
+// Names are immutable once stored, so they are packed back to back into large blocks
+// instead of one heap allocation per string. Blocks never move, so a stored name can be
+// held as a string_view for the arena's lifetime. Space is not reclaimed when a record is
+// deleted; the arena is rebuilt when the data is next loaded.
+
+class StringArena {
+public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+private:
+    vector<unique_ptr<char[]>> blocks;
+    size_t used = BLOCK_SIZE;   // Bytes used in the last block
+    size_t total_bytes = 0;     // Bytes handed out over all blocks
+
+public:
+    // Copies text into the arena and returns a view of the copy.
+    string_view store(string_view text) {
+        if (text.empty()) return string_view();
+        char* dst;
+        if (text.size() > BLOCK_SIZE / 4) {
+            // Oversized strings get a block of their own, kept before the open block
+            unique_ptr<char[]> block(new char[text.size()]);
+            dst = block.get();
+            blocks.insert(blocks.empty() ? blocks.end() : blocks.end() - 1, std::move(block));
+        } else {
+            if (text.size() > BLOCK_SIZE - used) {
+                blocks.emplace_back(new char[BLOCK_SIZE]);
+                used = 0;
+            }
+            dst = blocks.back().get() + used;
+            used += text.size();
+        }
+        memcpy(dst, text.data(), text.size());
+        total_bytes += text.size();
+        return string_view(dst, text.size());
+    }
+
+    size_t bytes_stored() const { return total_bytes; }
+
+    void clear() {
+        blocks.clear();
+        used = BLOCK_SIZE;
+        total_bytes = 0;
+    }
+};
+
+// Maps Group IDs to dense 32-bit handles (starting at 1; NO_GROUP is 0) and back, so an
+// individual's group membership is one integer instead of a copy of the ID string.
+// Handles stay valid for the interner's lifetime, also after the group is deleted.
+// key_of() is the membership index: it takes an individual's handle straight to the
+// parsed key of their group, so finding the group is one integer-keyed tree probe.
+class GroupIdInterner {
+private:
+    StringArena ids_arena;
+    vector<string_view> ids{string_view()}; // ids[handle]; ids[NO_GROUP] is empty
+    vector<GroupKey> keys{GroupKey()};      // keys[handle], viewing ids[handle]
+    unordered_map<string_view, GroupHandle> handles;
+
+public:
+    GroupHandle intern(string_view group_id) {
+        if (group_id.empty()) return NO_GROUP;
+        auto it = handles.find(group_id);
+        if (it != handles.end()) return it->second;
+        string_view stored = ids_arena.store(group_id);
+        GroupHandle handle = static_cast<GroupHandle>(ids.size());
+        ids.push_back(stored);
+        keys.emplace_back(stored);
+        handles.emplace(stored, handle);
+        return handle;
+    }
+
+    // The Group ID of a handle; empty for NO_GROUP.
+    string_view id_of(GroupHandle handle) const {
+        return handle < ids.size() ? ids[handle] : string_view();
+    }
+
+    // The group key of a handle, viewing the interned ID. Default (empty) for NO_GROUP.
+    const GroupKey& key_of(GroupHandle handle) const {
+        return handle < keys.size() ? keys[handle] : keys[NO_GROUP];
+    }
+
+    // One past the largest handle handed out (handles are dense).
+    size_t size() const { return ids.size(); }
+
+    void clear() {
+        handles.clear();
+        ids.assign(1, string_view());
+        keys.assign(1, GroupKey());
+        ids_arena.clear();
+    }
+};
+
+// --- Instrumentation ---
+// Optional per-operation counters, compiled in with -DSTEP_TRACKER_STATS: call counts,
+// latency histograms, B+ tree probes, allocations through the app's memory resources, and
+// bytes written. Every thread has its own counter block and is the only writer to it, so
+// an update is a relaxed load and store rather than a locked increment; collect_stats()
+// sums the blocks of all live threads and of those that have exited. Counters are charged
+// to the innermost operation running on the thread (task pool chunks inherit the
+// submitting operation); latency covers the whole call, including nested operations.
+// Without the flag the hooks expand to nothing and collect_stats() returns an empty
+// snapshot with enabled == false.
+
+enum class StatOp : uint8_t {
+    Unattributed, Load, SaveSnapshot, ExportCsv, JournalCommit, Render,
+    AddPerson, CreateGroup, DeleteIndividual, DeleteIndividuals, DeleteGroup, MergeGroups,
+    RecordSteps, AdvanceDay, TopIndividuals, RankQuery, Rewards, GroupAchievement, LeaderBoard, GroupRange,
+    GoalSuggestion, GoalSuggestionsForAll, Analysis,
+    Count
+};
+
+inline const char* stat_op_name(StatOp op) {
+    static const char* const names[] = {
+        "unattributed", "load", "save_snapshot", "export_csv", "journal_commit", "render",
+        "add_person", "create_group", "delete_individual", "delete_individuals", "delete_group", "merge_groups",
+        "record_steps", "advance_day", "top_individuals", "rank_query", "rewards", "group_achievement", "leader_board", "group_range",
+        "goal_suggestion", "goal_suggestions_for_all", "analysis"};
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(StatOp::Count), "one name per StatOp");
+    return names[static_cast<size_t>(op)];
+}
+
+struct OpStats {
+    static constexpr size_t BUCKETS = 40; // Bucket b counts calls of [2^(b-1), 2^b) ns; bucket 0 is 0 ns
+
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t tree_probes = 0;   // Root-to-leaf descents in the B+ trees
+    uint64_t allocations = 0;   // Upstream allocations of the tree pools and scratch arenas
+    uint64_t bytes_written = 0; // Journal, snapshot and CSV output
+    array<uint64_t, BUCKETS> latency_buckets{};
+
+    static size_t bucket_of(uint64_t ns) {
+        size_t bucket = 0;
+        while (ns != 0 && bucket < BUCKETS - 1) {
+            ns >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    // Upper bound, in ns, of the latency under which `fraction` of the calls completed.
+    uint64_t latency_percentile_ns(double fraction) const {
+        uint64_t wanted = static_cast<uint64_t>(fraction * static_cast<double>(calls));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            seen += latency_buckets[bucket];
+            if (seen > wanted || (seen == calls && seen > 0)) return bucket == 0 ? 0 : uint64_t(1) << bucket;
+        }
+        return 0;
+    }
+};
+
+struct StatsSnapshot {
+    bool enabled = false;
+    array<OpStats, static_cast<size_t>(StatOp::Count)> ops{};
+
+    const OpStats& operator[](StatOp op) const { return ops[static_cast<size_t>(op)]; }
+};
+
+// One JSON object per snapshot, listing the operations that ran at least once.
+inline string format_stats_json(const StatsSnapshot& snapshot) {
+    string json = snapshot.enabled ? "{\"enabled\":true,\"ops\":[" : "{\"enabled\":false,\"ops\":[";
+    bool first = true;
+    char field[320];
+    for (size_t i = 0; i < snapshot.ops.size(); ++i) {
+        const OpStats& op = snapshot.ops[i];
+        if (op.calls == 0 && op.tree_probes == 0 && op.allocations == 0 && op.bytes_written == 0) continue;
+        snprintf(field, sizeof(field),
+                 "%s{\"op\":\"%s\",\"calls\":%llu,\"total_us\":%.1f,\"p50_us\":%.1f,\"p99_us\":%.1f,"
+                 "\"tree_probes\":%llu,\"allocations\":%llu,\"bytes_written\":%llu}",
+                 first ? "" : ",", stat_op_name(static_cast<StatOp>(i)), static_cast<unsigned long long>(op.calls),
+                 op.total_ns / 1e3, op.latency_percentile_ns(0.50) / 1e3, op.latency_percentile_ns(0.99) / 1e3,
+                 static_cast<unsigned long long>(op.tree_probes), static_cast<unsigned long long>(op.allocations),
+                 static_cast<unsigned long long>(op.bytes_written));
+        json += field;
+        first = false;
+    }
+    json += "]}";
+    return json;
+}
+
+#ifdef STEP_TRACKER_STATS
+
+// The counters of one thread. Only the owning thread writes them; snapshots read them.
+struct ThreadStatBlock {
+    struct Counters {
+        atomic<uint64_t> calls{0};
+        atomic<uint64_t> total_ns{0};
+        atomic<uint64_t> tree_probes{0};
+        atomic<uint64_t> allocations{0};
+        atomic<uint64_t> bytes_written{0};
+        array<atomic<uint64_t>, OpStats::BUCKETS> latency_buckets{};
+    };
+
+    array<Counters, static_cast<size_t>(StatOp::Count)> ops;
+    StatOp current = StatOp::Unattributed; // Operation new counts are charged to
+
+    ThreadStatBlock();
+    ~ThreadStatBlock();
+
+    Counters& counters() { return ops[static_cast<size_t>(current)]; }
+
+    static void add(atomic<uint64_t>& counter, uint64_t amount) {
+        counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+
+    void add_to(StatsSnapshot& snapshot) const {
+        for (size_t i = 0; i < ops.size(); ++i) {
+            OpStats& out = snapshot.ops[i];
+            out.calls += ops[i].calls.load(memory_order_relaxed);
+            out.total_ns += ops[i].total_ns.load(memory_order_relaxed);
+            out.tree_probes += ops[i].tree_probes.load(memory_order_relaxed);
+            out.allocations += ops[i].allocations.load(memory_order_relaxed);
+            out.bytes_written += ops[i].bytes_written.load(memory_order_relaxed);
+            for (size_t b = 0; b < OpStats::BUCKETS; ++b) out.latency_buckets[b] += ops[i].latency_buckets[b].load(memory_order_relaxed);
+        }
+    }
+};
+
+// Every live thread's block, plus the folded totals of threads that have exited.
+class StatRegistry {
+private:
+    mutex registry_mutex;
+    vector<const ThreadStatBlock*> live;
+    StatsSnapshot retired;
+
+public:
+    static StatRegistry& instance() {
+        static StatRegistry registry; // Constructed before, so destroyed after, any thread's block
+        return registry;
+    }
+
+    void add(const ThreadStatBlock* block) {
+        lock_guard<mutex> lock(registry_mutex);
+        live.push_back(block);
+    }
+
+    void retire(const ThreadStatBlock* block) {
+        lock_guard<mutex> lock(registry_mutex);
+        block->add_to(retired);
+        live.erase(remove(live.begin(), live.end(), block), live.end());
+    }
+
+    StatsSnapshot collect() {
+        lock_guard<mutex> lock(registry_mutex);
+        StatsSnapshot snapshot = retired;
+        for (const ThreadStatBlock* block : live) block->add_to(snapshot);
+        snapshot.enabled = true;
+        return snapshot;
+    }
+};
+
+inline ThreadStatBlock::ThreadStatBlock() { StatRegistry::instance().add(this); }
+inline ThreadStatBlock::~ThreadStatBlock() { StatRegistry::instance().retire(this); }
+
+inline ThreadStatBlock& thread_stat_block() {
+    thread_local ThreadStatBlock block;
+    return block;
+}
+
+// Times one call of an operation and charges the thread's counters to it meanwhile.
+class StatScope {
+private:
+    ThreadStatBlock& block;
+    StatOp op;
+    StatOp outer;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit StatScope(StatOp op)
+        : block(thread_stat_block()), op(op), outer(block.current), start(chrono::steady_clock::now()) {
+        block.current = op;
+    }
+    StatScope(const StatScope&) = delete;
+    StatScope& operator=(const StatScope&) = delete;
+
+    ~StatScope() {
+        uint64_t ns = static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        ThreadStatBlock::Counters& counters = block.ops[static_cast<size_t>(op)];
+        ThreadStatBlock::add(counters.calls, 1);
+        ThreadStatBlock::add(counters.total_ns, ns);
+        ThreadStatBlock::add(counters.latency_buckets[OpStats::bucket_of(ns)], 1);
+        block.current = outer;
+    }
+};
+
+// Charges the thread's counters to an operation started elsewhere (a task pool chunk).
+class StatAttribution {
+private:
+    ThreadStatBlock& block;
+    StatOp outer;
+
+public:
+    explicit StatAttribution(StatOp op) : block(thread_stat_block()), outer(block.current) { block.current = op; }
+    StatAttribution(const StatAttribution&) = delete;
+    StatAttribution& operator=(const StatAttribution&) = delete;
+    ~StatAttribution() { block.current = outer; }
+};
+
+inline StatsSnapshot collect_stats() { return StatRegistry::instance().collect(); }
+
+#define STEP_TRACKER_STAT_SCOPE(op) StatScope stat_scope(op)
+#define STEP_TRACKER_STAT_COUNT(field, amount) ThreadStatBlock::add(thread_stat_block().counters().field, amount)
+
+#else
+
+inline StatsSnapshot collect_stats() { return StatsSnapshot(); }
+
+#define STEP_TRACKER_STAT_SCOPE(op) ((void)0)
+#define STEP_TRACKER_STAT_COUNT(field, amount) ((void)0)
+
+#endif
+
+// Writes a stats snapshot as a JSON line to `out` every `interval` from a background
+// thread, until destroyed. `out` must outlive the dumper and should not be written by
+// other threads meanwhile.
+class StatsDumper {
+private:
+    mutex dump_mutex;
+    condition_variable wake;
+    bool stopping = false;
+    thread worker; // Declared last: starts after the members it uses
+
+public:
+    StatsDumper(chrono::milliseconds interval, ostream& out)
+        : worker([this, interval, &out] {
+              unique_lock<mutex> lock(dump_mutex);
+              while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+                  out << format_stats_json(collect_stats()) << endl;
+              }
+          }) {}
+    StatsDumper(const StatsDumper&) = delete;
+    StatsDumper& operator=(const StatsDumper&) = delete;
+
+    ~StatsDumper() {
+        {
+            lock_guard<mutex> lock(dump_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+};
+
+// --- Memory Resources ---
+// Tree nodes come from per-tree pool resources and short-lived query buffers from
+// stack-backed scratch arenas. The counting resource sits upstream of both, so the app
+// can report how often they actually reach the global heap.
+
+struct AllocationStats {
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t bytes_in_use = 0;
+    size_t peak_bytes = 0;
+};
+
+// Forwards to an upstream resource and counts the traffic. Thread-safe, so it can
+// sit behind scratch arenas used by concurrent readers.
+class CountingResource : public pmr::memory_resource {
+private:
+    pmr::memory_resource* upstream;
+    atomic<size_t> allocations{0};
+    atomic<size_t> deallocations{0};
+    atomic<size_t> bytes_in_use{0};
+    atomic<size_t> peak_bytes{0};
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = upstream->allocate(bytes, alignment);
+        allocations.fetch_add(1, memory_order_relaxed);
+        STEP_TRACKER_STAT_COUNT(allocations, 1);
+        size_t in_use = bytes_in_use.fetch_add(bytes, memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes.load(memory_order_relaxed);
+        while (in_use > peak && !peak_bytes.compare_exchange_weak(peak, in_use, memory_order_relaxed)) {}
+        return memory;
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        upstream->deallocate(memory, bytes, alignment);
+        deallocations.fetch_add(1, memory_order_relaxed);
+        bytes_in_use.fetch_sub(bytes, memory_order_relaxed);
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    explicit CountingResource(pmr::memory_resource* up = pmr::new_delete_resource()) : upstream(up) {}
+
+    AllocationStats stats() const {
+        AllocationStats result;
+        result.allocations = allocations.load(memory_order_relaxed);
+        result.deallocations = deallocations.load(memory_order_relaxed);
+        result.bytes_in_use = bytes_in_use.load(memory_order_relaxed);
+        result.peak_bytes = peak_bytes.load(memory_order_relaxed);
+        return result;
+    }
+};
+
+// Per-query scratch memory: a bump allocator over an inline buffer, spilling to the
+// upstream resource only for large queries. Individual frees are no-ops; everything is
+// released at once when the arena goes out of scope at the end of the query.
+class ScratchArena {
+public:
+    static constexpr size_t INLINE_BYTES = 4096;
+
+private:
+    alignas(max_align_t) byte buffer[INLINE_BYTES];
+    pmr::monotonic_buffer_resource arena;
+
+public:
+    explicit ScratchArena(pmr::memory_resource* upstream = pmr::new_delete_resource())
+        : arena(buffer, sizeof(buffer), upstream) {}
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    pmr::memory_resource* resource() { return &arena; }
+};
+
+// --- B+ Tree Implementation ---
+// Node-based in-memory B+ tree. Internal nodes hold up to Fanout children and
+// route by separator keys; all items live in leaf pages that are linked left to
+// right, so insert, remove and search are O(log n) and in-order scans just walk
+// the leaf chain. Items inside a leaf are kept sorted by their key.
+
+// Key extractor that reads a data member directly. Returning a reference keeps every
+// probe inlinable and allocation-free, unlike a std::function returning the key by value.
+template <typename T, typename KeyType, KeyType T::*Member>
+struct MemberKey {
+    const KeyType& operator()(const T& obj) const noexcept { return obj.*Member; }
+};
+
+// KeyOf is any callable mapping const T& to the key (by value or by const reference).
+template <typename T, typename KeyType, typename KeyOf = function<KeyType(const T&)>,
+          typename Compare = less<KeyType>, size_t Fanout = 32>
+class ConceptualBPlusTree {
+    static_assert(Fanout >= 4, "ConceptualBPlusTree requires a fanout of at least 4");
+
+private:
+    struct Node;
+
+    // Nodes and their key/child/item arrays come from the tree's pool, so node churn
+    // reuses fixed-size blocks instead of going to the global heap.
+    struct NodeDeleter {
+        pmr::memory_resource* pool = nullptr;
+        void operator()(Node* node) const {
+            node->~Node();
+            pool->deallocate(node, sizeof(Node), alignof(Node));
+        }
+    };
+    using OwnedNode = unique_ptr<Node, NodeDeleter>;
+
+    // A single node type is used for both leaves and internal nodes.
+    // Internal nodes: keys[i] is the smallest key reachable through children[i + 1].
+    // Leaf nodes: items holds the sorted payload, prev/next link neighbouring leaves.
+    struct Node {
+        bool is_leaf;
+        pmr::vector<KeyType> keys;
+        pmr::vector<OwnedNode> children;
+        pmr::vector<T> items;
+        Node* prev = nullptr;
+        Node* next = nullptr;
+
+        Node(bool leaf, pmr::memory_resource* pool) : is_leaf(leaf), keys(pool), children(pool), items(pool) {
+            if (leaf) items.reserve(Fanout + 1); // Room for one overflow item before a split
+            else { keys.reserve(Fanout); children.reserve(Fanout + 1); }
+        }
+    };
+
+    // Result of inserting into a subtree: the new right sibling if the child split.
+    struct SplitResult {
+        OwnedNode right;
+        KeyType separator;
+    };
+
+    static constexpr size_t MIN_LEAF_ITEMS = Fanout / 2;
+    static constexpr size_t MIN_CHILDREN = (Fanout + 1) / 2;
+
+    unique_ptr<pmr::unsynchronized_pool_resource> node_pool; // Declared before root: outlives the nodes
+    OwnedNode root;
+    size_t item_count = 0;
+    Compare comp; // Comparator for key comparison
+    // Extracts the key from an object of type T
+    KeyOf key_extractor;
+
+    bool keys_equal(const KeyType& a, const KeyType& b) const {
+        return !comp(a, b) && !comp(b, a);
+    }
+
+    // Index of the child of an internal node that may contain the key.
+    size_t child_index(const Node* node, const KeyType& key) const {
+        return upper_bound(node->keys.begin(), node->keys.end(), key,
+                           [this](const KeyType& k, const KeyType& sep) { return comp(k, sep); })
+               - node->keys.begin();
+    }
+
+    // Position of the first item in a leaf whose key is not less than the given key.
+    size_t leaf_lower_bound(const Node* leaf, const KeyType& key) const {
+        return lower_bound(leaf->items.begin(), leaf->items.end(), key,
+                           [this](const T& obj, const KeyType& k) { return comp(key_extractor(obj), k); })
+               - leaf->items.begin();
+    }
+
+    // Descends from the root to the leaf that may contain the key.
+    Node* find_leaf(const KeyType& key) const {
+        STEP_TRACKER_STAT_COUNT(tree_probes, 1);
+        Node* node = root.get();
+        while (!node->is_leaf) {
+            node = node->children[child_index(node, key)].get();
+        }
+        return node;
+    }
+
+    OwnedNode new_node(bool leaf) {
+        void* memory = node_pool->allocate(sizeof(Node), alignof(Node));
+        return OwnedNode(new (memory) Node(leaf, node_pool.get()), NodeDeleter{node_pool.get()});
+    }
+
+    Node* leftmost_leaf() const {
+        Node* node = root.get();
+        while (!node->is_leaf) {
+            node = node->children.front().get();
+        }
+        return node;
+    }
+
+    // Recursively inserts into the subtree rooted at node. Returns false on a duplicate key.
+    bool insert_into(Node* node, const KeyType& key, T&& item, SplitResult& split) {
+        if (node->is_leaf) {
+            size_t pos = leaf_lower_bound(node, key);
+            if (pos < node->items.size() && keys_equal(key, key_extractor(node->items[pos]))) {
+                return false; // Duplicate checks are handled externally before calling insert.
+            }
+            node->items.insert(node->items.begin() + pos, std::move(item));
+            if (node->items.size() > Fanout) {
+                split_leaf(node, split);
+            }
+            return true;
+        }
+
+        size_t idx = child_index(node, key);
+        SplitResult child_split;
+        if (!insert_into(node->children[idx].get(), key, std::move(item), child_split)) {
+            return false;
+        }
+        if (child_split.right) {
+            node->keys.insert(node->keys.begin() + idx, std::move(child_split.separator));
+            node->children.insert(node->children.begin() + idx + 1, std::move(child_split.right));
+            if (node->children.size() > Fanout) {
+                split_internal(node, split);
+            }
+        }
+        return true;
+    }
+
+    // Moves the upper half of an overflowing leaf into a new right sibling.
+    void split_leaf(Node* leaf, SplitResult& split) {
+        auto right = new_node(true);
+        size_t mid = leaf->items.size() / 2;
+        move(leaf->items.begin() + mid, leaf->items.end(), back_inserter(right->items));
+        leaf->items.erase(leaf->items.begin() + mid, leaf->items.end());
+
+        right->next = leaf->next;
+        right->prev = leaf;
+        if (leaf->next) leaf->next->prev = right.get();
+        leaf->next = right.get();
+
+        split.separator = key_extractor(right->items.front());
+        split.right = std::move(right);
+    }
+
+    // Moves the upper half of an overflowing internal node into a new right sibling.
+    void split_internal(Node* node, SplitResult& split) {
+        auto right = new_node(false);
+        size_t mid = node->keys.size() / 2; // keys[mid] moves up to the parent
+        split.separator = std::move(node->keys[mid]);
+        move(node->keys.begin() + mid + 1, node->keys.end(), back_inserter(right->keys));
+        move(node->children.begin() + mid + 1, node->children.end(), back_inserter(right->children));
+        node->keys.erase(node->keys.begin() + mid, node->keys.end());
+        node->children.erase(node->children.begin() + mid + 1, node->children.end());
+        split.right = std::move(right);
+    }
+
+    bool underflows(const Node* node) const {
+        return node->is_leaf ? node->items.size() < MIN_LEAF_ITEMS : node->children.size() < MIN_CHILDREN;
+    }
+
+    bool can_lend(const Node* node) const {
+        return node->is_leaf ? node->items.size() > MIN_LEAF_ITEMS : node->children.size() > MIN_CHILDREN;
+    }
+
+    // Recursively removes the key from the subtree rooted at node. Returns false if not found.
+    bool remove_from(Node* node, const KeyType& key) {
+        if (node->is_leaf) {
+            size_t pos = leaf_lower_bound(node, key);
+            if (pos >= node->items.size() || !keys_equal(key, key_extractor(node->items[pos]))) {
+                return false;
+            }
+            node->items.erase(node->items.begin() + pos);
+            return true;
+        }
+
+        size_t idx = child_index(node, key);
+        if (!remove_from(node->children[idx].get(), key)) {
+            return false;
+        }
+        if (underflows(node->children[idx].get())) {
+            rebalance_child(node, idx);
+        }
+        return true;
+    }
+
+    // Restores the minimum occupancy of parent->children[idx] by borrowing from
+    // a sibling, or by merging with one when neither sibling can spare an entry.
+    void rebalance_child(Node* parent, size_t idx) {
+        Node* child = parent->children[idx].get();
+        Node* left = idx > 0 ? parent->children[idx - 1].get() : nullptr;
+        Node* right = idx + 1 < parent->children.size() ? parent->children[idx + 1].get() : nullptr;
+
+        if (left && can_lend(left)) {
+            if (child->is_leaf) {
+                child->items.insert(child->items.begin(), std::move(left->items.back()));
+                left->items.pop_back();
+                parent->keys[idx - 1] = key_extractor(child->items.front());
+            } else {
+                child->keys.insert(child->keys.begin(), std::move(parent->keys[idx - 1]));
+                child->children.insert(child->children.begin(), std::move(left->children.back()));
+                parent->keys[idx - 1] = std::move(left->keys.back());
+                left->keys.pop_back();
+                left->children.pop_back();
+            }
+            return;
+        }
+        if (right && can_lend(right)) {
+            if (child->is_leaf) {
+                child->items.push_back(std::move(right->items.front()));
+                right->items.erase(right->items.begin());
+                parent->keys[idx] = key_extractor(right->items.front());
+            } else {
+                child->keys.push_back(std::move(parent->keys[idx]));
+                child->children.push_back(std::move(right->children.front()));
+                parent->keys[idx] = std::move(right->keys.front());
+                right->keys.erase(right->keys.begin());
+                right->children.erase(right->children.begin());
+            }
+            return;
+        }
+        // Neither sibling can lend: merge the child into its left sibling, or the right sibling into the child.
+        if (left) {
+            merge_with_right(parent, idx - 1);
+        } else if (right) {
+            merge_with_right(parent, idx);
+        }
+    }
+
+    // Merges parent->children[idx + 1] into parent->children[idx] and drops the separator between them.
+    void merge_with_right(Node* parent, size_t idx) {
+        Node* dst = parent->children[idx].get();
+        Node* src = parent->children[idx + 1].get();
+        if (dst->is_leaf) {
+            move(src->items.begin(), src->items.end(), back_inserter(dst->items));
+            dst->next = src->next;
+            if (src->next) src->next->prev = dst;
+        } else {
+            dst->keys.push_back(std::move(parent->keys[idx]));
+            move(src->keys.begin(), src->keys.end(), back_inserter(dst->keys));
+            move(src->children.begin(), src->children.end(), back_inserter(dst->children));
+        }
+        parent->keys.erase(parent->keys.begin() + idx);
+        parent->children.erase(parent->children.begin() + idx + 1);
+    }
+
+    // Replaces the whole tree with items that are already sorted by key and free of duplicates.
+    // Builds bottom-up in O(n): leaves are filled evenly, then each internal level is formed
+    // from the one below, so every node satisfies the minimum occupancy rules.
+    void build_from_sorted(vector<T>&& items) {
+        item_count = items.size();
+        if (items.size() <= Fanout) {
+            root = new_node(true);
+            move(items.begin(), items.end(), back_inserter(root->items));
+            return;
+        }
+
+        // Level entries are (node, smallest key in its subtree)
+        vector<pair<OwnedNode, KeyType>> level;
+        size_t leaf_count = (items.size() + Fanout - 1) / Fanout;
+        level.reserve(leaf_count);
+        Node* prev_leaf = nullptr;
+        size_t offset = 0;
+        for (size_t i = 0; i < leaf_count; ++i) {
+            size_t take = items.size() / leaf_count + (i < items.size() % leaf_count ? 1 : 0);
+            auto leaf = new_node(true);
+            move(items.begin() + offset, items.begin() + offset + take, back_inserter(leaf->items));
+            offset += take;
+            leaf->prev = prev_leaf;
+            if (prev_leaf) prev_leaf->next = leaf.get();
+            prev_leaf = leaf.get();
+            KeyType first_key = key_extractor(leaf->items.front());
+            level.emplace_back(std::move(leaf), std::move(first_key));
+        }
+
+        while (level.size() > 1) {
+            vector<pair<OwnedNode, KeyType>> parents;
+            size_t parent_count = (level.size() + Fanout - 1) / Fanout;
+            parents.reserve(parent_count);
+            size_t child = 0;
+            for (size_t i = 0; i < parent_count; ++i) {
+                size_t take = level.size() / parent_count + (i < level.size() % parent_count ? 1 : 0);
+                auto node = new_node(false);
+                KeyType first_key = std::move(level[child].second);
+                for (size_t j = 0; j < take; ++j, ++child) {
+                    if (j > 0) node->keys.push_back(std::move(level[child].second));
+                    node->children.push_back(std::move(level[child].first));
+                }
+                parents.emplace_back(std::move(node), std::move(first_key));
+            }
+            level = std::move(parents);
+        }
+        root = std::move(level.front().first);
+    }
+
+public:
+    // Forward iterator over items in key order, walking the linked leaf pages.
+    template <bool IsConst>
+    class basic_iterator {
+        using NodePtr = conditional_t<IsConst, const Node*, Node*>;
+        NodePtr leaf = nullptr;
+        size_t pos = 0;
+        friend class ConceptualBPlusTree;
+
+        basic_iterator(NodePtr leaf, size_t pos) : leaf(leaf), pos(pos) { skip_empty(); }
+
+        void skip_empty() {
+            while (leaf && pos >= leaf->items.size()) {
+                leaf = leaf->next;
+                pos = 0;
+            }
+        }
+
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = conditional_t<IsConst, const T*, T*>;
+        using reference = conditional_t<IsConst, const T&, T&>;
+
+        basic_iterator() = default;
+        // Allow iterator -> const_iterator conversion
+        template <bool C = IsConst, typename = enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& other) : leaf(other.leaf), pos(other.pos) {}
+
+        reference operator*() const { return leaf->items[pos]; }
+        pointer operator->() const { return &leaf->items[pos]; }
+        basic_iterator& operator++() { ++pos; skip_empty(); return *this; }
+        basic_iterator operator++(int) { basic_iterator tmp = *this; ++*this; return tmp; }
+        bool operator==(const basic_iterator& other) const { return leaf == other.leaf && pos == other.pos; }
+        bool operator!=(const basic_iterator& other) const { return !(*this == other); }
+
+        template <bool> friend class basic_iterator;
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    // Constructor takes a key extractor, an optional comparator, and the resource the node
+    // pool draws its blocks from
+    explicit ConceptualBPlusTree(KeyOf extractor = KeyOf(), Compare c = Compare(),
+                                 pmr::memory_resource* upstream = pmr::new_delete_resource())
+        : node_pool(make_unique<pmr::unsynchronized_pool_resource>(upstream)), comp(std::move(c)),
+          key_extractor(std::move(extractor)) {
+        root = new_node(true);
+    }
+
+    // Inserts an item into the tree, maintaining sorted order by its key.
+    // Items whose key is already present are not inserted.
+    void insert(const T& item) {
+        insert(T(item));
+    }
+
+    void insert(T&& item) {
+        KeyType item_key = key_extractor(item); // Extract key from the item
+        SplitResult split;
+        if (!insert_into(root.get(), item_key, std::move(item), split)) {
+            return;
+        }
+        ++item_count;
+        if (split.right) { // Root split: grow the tree by one level
+            auto new_root = new_node(false);
+            new_root->children.push_back(std::move(root));
+            new_root->children.push_back(std::move(split.right));
+            new_root->keys.push_back(std::move(split.separator));
+            root = std::move(new_root);
+        }
+    }
+
+    // Removes an item from the tree by its key.
+    bool remove(const KeyType& key) {
+        if (!remove_from(root.get(), key)) {
+            return false; // Item not found
+        }
+        --item_count;
+        if (!root->is_leaf && root->children.size() == 1) { // Shrink the tree by one level
+            OwnedNode only_child = std::move(root->children.front());
+            root = std::move(only_child);
+        }
+        return true; // Item successfully removed
+    }
+
+    // Replaces the contents of the tree with items, building it bottom-up in O(n) when they
+    // are already in strictly increasing key order (e.g. a snapshot written in tree order).
+    // Unsorted input falls back to one stable sort; for duplicate keys the first item wins,
+    // matching insert().
+    void bulk_load(vector<T> items) {
+        auto key_less = [this](const T& a, const T& b) { return comp(key_extractor(a), key_extractor(b)); };
+        bool strictly_sorted = adjacent_find(items.begin(), items.end(),
+                                             [&](const T& a, const T& b) { return !key_less(a, b); }) == items.end();
+        if (!strictly_sorted) {
+            stable_sort(items.begin(), items.end(), key_less);
+            items.erase(unique(items.begin(), items.end(),
+                               [this](const T& a, const T& b) { return keys_equal(key_extractor(a), key_extractor(b)); }),
+                        items.end());
+        }
+        build_from_sorted(std::move(items));
+    }
+
+    // Removes every item whose key appears in keys and returns how many were removed.
+    // Small batches are removed one by one in O(k log n); larger ones are applied in a
+    // single merge pass over the leaf chain followed by an O(n) bottom-up rebuild.
+    size_t remove_many(vector<KeyType> keys) {
+        if (keys.empty() || item_count == 0) return 0;
+        sort(keys.begin(), keys.end(), comp);
+        keys.erase(unique(keys.begin(), keys.end(),
+                          [this](const KeyType& a, const KeyType& b) { return keys_equal(a, b); }),
+                   keys.end());
+
+        size_t depth = 1;
+        for (size_t n = item_count; n > Fanout; n /= Fanout) ++depth;
+        if (keys.size() * depth * Fanout < item_count) {
+            size_t removed = 0;
+            for (const KeyType& key : keys) {
+                if (remove(key)) ++removed;
+            }
+            return removed;
+        }
+
+        vector<T> survivors;
+        survivors.reserve(item_count);
+        auto key_it = keys.begin();
+        for (iterator it = begin(); it != end(); ++it) {
+            const KeyType& item_key = key_extractor(*it);
+            while (key_it != keys.end() && comp(*key_it, item_key)) ++key_it;
+            if (key_it != keys.end() && keys_equal(*key_it, item_key)) continue; // Drop this item
+            survivors.push_back(std::move(*it));
+        }
+        size_t removed = item_count - survivors.size();
+        build_from_sorted(std::move(survivors));
+        return removed;
+    }
+
+    // Searches for an item by its key and returns a pointer to it.
+    // Returns nullptr if the item is not found. The pointer is invalidated by the next insert or remove.
+    T* search(const KeyType& key) {
+        Node* leaf = find_leaf(key);
+        size_t pos = leaf_lower_bound(leaf, key);
+        if (pos < leaf->items.size() && keys_equal(key, key_extractor(leaf->items[pos]))) {
+            return &leaf->items[pos]; // Return a pointer to the found object
+        }
+        return nullptr; // Item not found
+    }
+
+    const T* search(const KeyType& key) const {
+        return const_cast<ConceptualBPlusTree*>(this)->search(key);
+    }
+
+    // In-order iteration over all items; items may be modified as long as their key is not.
+    iterator begin() { return iterator(leftmost_leaf(), 0); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return const_iterator(leftmost_leaf(), 0); }
+    const_iterator end() const { return const_iterator(); }
+
+    // Non-owning view over a contiguous key range of the tree: an iterator pair into the
+    // leaf pages. Iterating it does not copy items. Like pointers returned by search, a view
+    // is invalidated by the next insert or remove.
+    template <typename Iter>
+    class basic_range_view {
+        Iter first, last;
+
+    public:
+        basic_range_view(Iter first, Iter last) : first(first), last(last) {}
+        Iter begin() const { return first; }
+        Iter end() const { return last; }
+        bool empty() const { return first == last; }
+    };
+    using range_view = basic_range_view<iterator>;
+    using const_range_view = basic_range_view<const_iterator>;
+
+    // Returns a view of the items whose keys lie within [start_key, end_key] (inclusive).
+    range_view range(const KeyType& start_key, const KeyType& end_key) {
+        if (comp(end_key, start_key)) return range_view(end(), end());
+        return range_view(lower_bound_it(start_key), upper_bound_it(end_key));
+    }
+
+    const_range_view range(const KeyType& start_key, const KeyType& end_key) const {
+        if (comp(end_key, start_key)) return const_range_view(end(), end());
+        return const_range_view(const_cast<ConceptualBPlusTree*>(this)->lower_bound_it(start_key),
+                                const_cast<ConceptualBPlusTree*>(this)->upper_bound_it(end_key));
+    }
+
+    // Iterator to the first item whose key is not less than key.
+    iterator lower_bound_it(const KeyType& key) {
+        Node* leaf = find_leaf(key);
+        return iterator(leaf, leaf_lower_bound(leaf, key));
+    }
+
+    // Iterator to the first item whose key is greater than key.
+    iterator upper_bound_it(const KeyType& key) {
+        Node* leaf = find_leaf(key);
+        size_t pos = upper_bound(leaf->items.begin(), leaf->items.end(), key,
+                                 [this](const KeyType& k, const T& obj) { return comp(k, key_extractor(obj)); })
+                     - leaf->items.begin();
+        return iterator(leaf, pos);
+    }
+
+    // Retrieves copies of the items within a specified key range (inclusive).
+    // Prefer range() when the caller only needs to read the items.
+    vector<T> getRange(const KeyType& start_key, const KeyType& end_key) const {
+        const_range_view view = range(start_key, end_key);
+        return vector<T>(view.begin(), view.end());
+    }
+
+    // Same, with the copies allocated from a caller-provided (e.g. per-query scratch) resource.
+    pmr::vector<T> getRange(const KeyType& start_key, const KeyType& end_key, pmr::memory_resource* resource) const {
+        const_range_view view = range(start_key, end_key);
+        return pmr::vector<T>(view.begin(), view.end(), resource);
+    }
+
+    // Returns the number of items currently in the tree.
+    size_t size() const {
+        return item_count;
+    }
+};
+
+// --- Step Aggregation Kernels ---
+// Per-row weekly sum and goal-achievement count over StepStore rows, used to seed a row's
+// running stats whenever the row is (re)written as a whole. Rows are padded to
+// STEP_ROW_STRIDE (8) int32 lanes with zeros, so on AVX2 a row is exactly one register:
+// one masked compare + popcount gives the days at or above the goal, and a widened
+// horizontal add gives the sum. NEON handles a row as two 4-lane vectors. The widest
+// kernel the CPU supports is picked once at runtime; the scalar loop is the fallback.
+
+constexpr size_t STEP_ROW_STRIDE = 8;
+
+struct StepRowStats {
+    long long total_steps = 0; // Sum of the row's valid days
+    int days_met_goal = 0;     // Valid days with steps >= the row's daily goal
+    int days = 0;              // Number of valid days
+};
+
+using StepRowKernel = void (*)(const int32_t* steps, const uint8_t* lengths, const int32_t* goals,
+                               size_t rows, StepRowStats* out);
+
+inline void analyze_step_rows_scalar(const int32_t* steps, const uint8_t* lengths, const int32_t* goals,
+                                     size_t rows, StepRowStats* out) {
+    for (size_t r = 0; r < rows; ++r) {
+        const int32_t* row = steps + r * STEP_ROW_STRIDE;
+        StepRowStats stats;
+        stats.days = lengths[r];
+        for (int day = 0; day < stats.days; ++day) {
+            stats.total_steps += row[day];
+            stats.days_met_goal += row[day] >= goals[r];
+        }
+        out[r] = stats;
+    }
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define STEP_TRACKER_HAVE_AVX2 1
+#include <immintrin.h>
+
+__attribute__((target("avx2,popcnt")))
+inline void analyze_step_rows_avx2(const int32_t* steps, const uint8_t* lengths, const int32_t* goals,
+                                   size_t rows, StepRowStats* out) {
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (size_t r = 0; r < rows; ++r) {
+        __m256i row = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(steps + r * STEP_ROW_STRIDE));
+        __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(lengths[r]), lane_index);
+        // steps >= goal  <=>  !(goal > steps), restricted to the valid lanes
+        __m256i met = _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(goals[r]), row), valid);
+        // Padding lanes are zero, so the sum can include all 8 lanes; widen to 64-bit first
+        __m256i wide = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(row)),
+                                        _mm256_cvtepi32_epi64(_mm256_extracti128_si256(row, 1)));
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+        half = _mm_add_epi64(half, _mm_unpackhi_epi64(half, half));
+
+        out[r].total_steps = _mm_cvtsi128_si64(half);
+        out[r].days_met_goal = _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(met))));
+        out[r].days = lengths[r];
+    }
+}
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define STEP_TRACKER_HAVE_NEON 1
+#include <arm_neon.h>
+
+inline void analyze_step_rows_neon(const int32_t* steps, const uint8_t* lengths, const int32_t* goals,
+                                   size_t rows, StepRowStats* out) {
+    const uint32_t low_lanes[4] = {0, 1, 2, 3};
+    const uint32_t high_lanes[4] = {4, 5, 6, 7};
+    const uint32x4_t lane_lo = vld1q_u32(low_lanes);
+    const uint32x4_t lane_hi = vld1q_u32(high_lanes);
+    for (size_t r = 0; r < rows; ++r) {
+        const int32_t* row = steps + r * STEP_ROW_STRIDE;
+        int32x4_t lo = vld1q_s32(row);
+        int32x4_t hi = vld1q_s32(row + 4);
+        uint32x4_t length = vdupq_n_u32(lengths[r]);
+        int32x4_t goal = vdupq_n_s32(goals[r]);
+        uint32x4_t met_lo = vandq_u32(vcgeq_s32(lo, goal), vcltq_u32(lane_lo, length));
+        uint32x4_t met_hi = vandq_u32(vcgeq_s32(hi, goal), vcltq_u32(lane_hi, length));
+        // Each met lane is all ones; shifting to 1 and adding counts them
+        uint32x4_t met = vaddq_u32(vshrq_n_u32(met_lo, 31), vshrq_n_u32(met_hi, 31));
+
+        out[r].total_steps = vaddlvq_s32(lo) + vaddlvq_s32(hi); // Padding lanes are zero
+        out[r].days_met_goal = static_cast<int>(vaddvq_u32(met));
+        out[r].days = lengths[r];
+    }
+}
+#endif
+
+// Picks the widest supported kernel once and reports its name.
+inline StepRowKernel select_step_row_kernel(const char** name = nullptr) {
+    static const pair<StepRowKernel, const char*> selected = []() -> pair<StepRowKernel, const char*> {
+#if defined(STEP_TRACKER_HAVE_AVX2)
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+            return {analyze_step_rows_avx2, "avx2"};
+        }
+#endif
+#if defined(STEP_TRACKER_HAVE_NEON)
+        return {analyze_step_rows_neon, "neon"};
+#endif
+        return {analyze_step_rows_scalar, "scalar"};
+    }();
+    if (name) *name = selected.second;
+    return selected.first;
+}
+
+// Analyzes rows with the best available kernel.
+inline void analyze_step_rows(const int32_t* steps, const uint8_t* lengths, const int32_t* goals,
+                              size_t rows, StepRowStats* out) {
+    select_step_row_kernel()(steps, lengths, goals, rows, out);
+}
+
+// --- Long-Term Step History ---
+// Days that have rolled out of the StepStore week, kept per row for windows of months.
+// A row's history is a run of blocks of up to BLOCK_DAYS consecutive days. Each block
+// stores its days as zigzag-encoded deltas in LEB128 varints (a typical day costs two or
+// three bytes) next to a summary of their sum, min, max and days at or above the goal, so
+// a window query adds up the summaries of the blocks it covers and decodes at most the
+// two blocks at its edges. Days are appended in order and never change once archived. A
+// block is sealed when it is full, when a day is skipped (a jump of more than a week
+// leaves days with no entry), or when the goal changes, so each block counts goal days
+// against one goal: the one in force when its days were archived.
+
+// Step statistics over a window of days.
+struct StepWindowStats {
+    long long total_steps = 0; // Sum of the days with an entry
+    int days_met_goal = 0;     // Days at or above the goal
+    int days = 0;              // Days in the window that have an entry
+    int min_steps = 0;         // Lowest and highest day (0 if there are no days)
+    int max_steps = 0;
+
+    void add_day(int32_t steps, bool met_goal) {
+        min_steps = days == 0 ? steps : min(min_steps, steps);
+        max_steps = days == 0 ? steps : max(max_steps, steps);
+        total_steps += steps;
+        days_met_goal += met_goal;
+        ++days;
+    }
+
+    void merge(const StepWindowStats& other) {
+        if (other.days == 0) return;
+        min_steps = days == 0 ? other.min_steps : min(min_steps, other.min_steps);
+        max_steps = days == 0 ? other.max_steps : max(max_steps, other.max_steps);
+        total_steps += other.total_steps;
+        days_met_goal += other.days_met_goal;
+        days += other.days;
+    }
+
+    StepRowStats row_stats() const { return StepRowStats{total_steps, days_met_goal, days}; }
+};
+
+// One block of archived days. Also the on-disk record of the snapshot's history section.
+struct StepHistoryBlock {
+    int32_t first_day;     // Day number of the block's first entry
+    uint32_t days;         // Consecutive days in the block
+    int64_t total_steps;
+    int32_t min_steps;
+    int32_t max_steps;
+    int32_t daily_goal;    // The goal days_met_goal counts against
+    uint32_t days_met_goal;
+    uint64_t byte_offset;  // Start of the encoded days in the series' bytes
+    uint32_t byte_length;
+    int32_t last_steps;    // The newest day, which the next day's delta is taken from
+
+    int last_day() const { return first_day + static_cast<int>(days) - 1; }
+
+    StepWindowStats summary() const {
+        return StepWindowStats{total_steps, static_cast<int>(days_met_goal), static_cast<int>(days), min_steps, max_steps};
+    }
+};
+
+static_assert(sizeof(StepHistoryBlock) == 48, "history blocks must have no padding");
+
+// The archived days of one row.
+struct StepSeries {
+    vector<StepHistoryBlock> blocks; // In day order
+    vector<uint8_t> bytes;           // The encoded days of every block, back to back
+
+    bool empty() const { return blocks.empty(); }
+};
+
+class StepHistory {
+public:
+    static constexpr uint32_t BLOCK_DAYS = 64;
+
+private:
+    vector<StepSeries> series; // By step slot; rows that never archived a day may be missing
+
+    static void append_varint(vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Reads one varint, stopping at end on truncated input.
+    static uint64_t read_varint(const uint8_t*& in, const uint8_t* end) {
+        uint64_t value = 0;
+        for (int shift = 0; in != end && shift < 64; shift += 7) {
+            uint8_t byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) break;
+        }
+        return value;
+    }
+
+    static uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+    static int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+public:
+    // Decodes a block's days, oldest first, into out.
+    static void decode(const StepSeries& row, const StepHistoryBlock& block, vector<int32_t>& out) {
+        const uint8_t* in = row.bytes.data() + block.byte_offset;
+        const uint8_t* end = in + block.byte_length;
+        int64_t steps = 0;
+        out.clear();
+        for (uint32_t i = 0; i < block.days; ++i) {
+            steps += unzigzag(read_varint(in, end));
+            out.push_back(static_cast<int32_t>(steps));
+        }
+    }
+
+private:
+    // Decodes a block and adds its days within [first_day, last_day] to out.
+    static void scan_block(const StepSeries& row, const StepHistoryBlock& block, int first_day, int last_day,
+                           StepWindowStats& out) {
+        const uint8_t* in = row.bytes.data() + block.byte_offset;
+        const uint8_t* end = in + block.byte_length;
+        int64_t steps = 0;
+        for (uint32_t i = 0; i < block.days; ++i) {
+            steps += unzigzag(read_varint(in, end));
+            int day = block.first_day + static_cast<int>(i);
+            if (day > last_day) break;
+            if (day >= first_day) out.add_day(static_cast<int32_t>(steps), steps >= block.daily_goal);
+        }
+    }
+
+public:
+    void clear() { series.clear(); }
+
+    void release(uint32_t slot) {
+        if (slot < series.size()) series[slot] = StepSeries();
+    }
+
+    // Archives a row's entry for `day`, which must come after the row's newest archived
+    // day. Returns false (and archives nothing) if it does not.
+    bool append(uint32_t slot, int day, int32_t steps, int32_t daily_goal) {
+        if (slot >= series.size()) series.resize(slot + 1);
+        StepSeries& row = series[slot];
+        StepHistoryBlock* block = row.blocks.empty() ? nullptr : &row.blocks.back();
+        if (block && day <= block->last_day()) return false;
+        if (!block || block->days == BLOCK_DAYS || day != block->last_day() + 1 || block->daily_goal != daily_goal) {
+            StepHistoryBlock fresh{};
+            fresh.first_day = day;
+            fresh.min_steps = steps;
+            fresh.max_steps = steps;
+            fresh.daily_goal = daily_goal;
+            fresh.byte_offset = row.bytes.size();
+            row.blocks.push_back(fresh);
+            block = &row.blocks.back();
+        }
+        size_t size_before = row.bytes.size();
+        append_varint(row.bytes, zigzag(static_cast<int64_t>(steps) - block->last_steps));
+        block->byte_length += static_cast<uint32_t>(row.bytes.size() - size_before);
+        block->min_steps = min(block->min_steps, steps);
+        block->max_steps = max(block->max_steps, steps);
+        block->total_steps += steps;
+        block->days_met_goal += steps >= daily_goal;
+        block->last_steps = steps;
+        ++block->days;
+        return true;
+    }
+
+    // Stats of a row's archived days within [first_day, last_day]: the summaries of the
+    // blocks inside the window, plus a decode of the blocks it cuts through.
+    StepWindowStats window(uint32_t slot, int first_day, int last_day) const {
+        StepWindowStats stats;
+        if (slot >= series.size() || first_day > last_day) return stats;
+        const StepSeries& row = series[slot];
+        auto block = lower_bound(row.blocks.begin(), row.blocks.end(), first_day,
+                                 [](const StepHistoryBlock& b, int day) { return b.last_day() < day; });
+        for (; block != row.blocks.end() && block->first_day <= last_day; ++block) {
+            if (block->first_day >= first_day && block->last_day() <= last_day) {
+                stats.merge(block->summary());
+            } else {
+                scan_block(row, *block, first_day, last_day, stats);
+            }
+        }
+        return stats;
+    }
+
+    // The row's archived days, or an empty series.
+    const StepSeries& series_of(uint32_t slot) const {
+        static const StepSeries empty;
+        return slot < series.size() ? series[slot] : empty;
+    }
+
+    // Replaces a row's archived days (loading a snapshot, moving an individual).
+    void assign(uint32_t slot, StepSeries row) {
+        if (row.empty()) {
+            release(slot);
+            return;
+        }
+        if (slot >= series.size()) series.resize(slot + 1);
+        series[slot] = std::move(row);
+    }
+
+    StepSeries take(uint32_t slot) {
+        StepSeries row;
+        if (slot < series.size()) row = std::move(series[slot]);
+        release(slot);
+        return row;
+    }
+};
+
+// --- Columnar Step Store ---
+// Step history for all individuals in one contiguous int32 matrix of [slot x day], so
+// aggregates over the population walk memory linearly instead of chasing one vector per
+// person. Each individual owns one row (its slot); freed rows are reused. Each row is a
+// ring of DAYS lanes holding the most recent entries: a row fills lanes 0.. in order, and
+// once it is full a new day overwrites the oldest lane and advances the row's head, so
+// rolling the week forward never shifts the other entries. The newest entry is today.
+// Parallel columns hold each row's daily goal and its running weekly sum and goal-day
+// count, which every write updates in O(1); the kernels recompute them when a row is
+// replaced wholesale. Lane order does not matter to either, and the valid lanes are
+// always [0, length). Entries evicted from a full row can be archived first into the
+// row's long-term StepHistory, which window() reads together with the live week.
+
+class StepStore {
+public:
+    static constexpr size_t DAYS = 7;
+    static constexpr size_t STRIDE = STEP_ROW_STRIDE; // Row pitch, padded for the SIMD kernels
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static_assert(DAYS <= STRIDE, "a week must fit in one padded row");
+
+private:
+    vector<int32_t> steps;        // steps[slot * STRIDE + lane]; lanes past the row's length are 0
+    vector<uint8_t> lengths;      // Number of valid days in each row (0 for free rows)
+    vector<uint8_t> heads;        // Lane of each row's oldest entry (0 until the row is full)
+    vector<int32_t> goals;        // Daily step goal of each row's individual
+    vector<int64_t> sums;         // Sum of each row's valid days
+    vector<uint8_t> goal_days;    // Valid days of each row at or above its goal
+    vector<uint32_t> free_slots;
+    StepHistory archive;          // Days that rolled out of each row
+
+    size_t lane_of(uint32_t slot, size_t day) const { return (heads[slot] + day) % DAYS; }
+
+    void recount(uint32_t slot) {
+        StepRowStats stats;
+        analyze_step_rows(&steps[slot * STRIDE], &lengths[slot], &goals[slot], 1, &stats);
+        sums[slot] = stats.total_steps;
+        goal_days[slot] = static_cast<uint8_t>(stats.days_met_goal);
+    }
+
+    // Replaces the value in one valid lane and returns the change in the row's sum.
+    long long replace_lane(uint32_t slot, size_t lane, int32_t value) {
+        int32_t& entry = steps[slot * STRIDE + lane];
+        long long delta = static_cast<long long>(value) - entry;
+        goal_days[slot] = static_cast<uint8_t>(goal_days[slot] - (entry >= goals[slot]) + (value >= goals[slot]));
+        sums[slot] += delta;
+        entry = value;
+        return delta;
+    }
+
+public:
+    size_t slot_count() const { return lengths.size(); }
+
+    void clear() {
+        steps.clear();
+        lengths.clear();
+        heads.clear();
+        goals.clear();
+        sums.clear();
+        goal_days.clear();
+        free_slots.clear();
+        archive.clear();
+    }
+
+    void reserve(size_t rows) {
+        steps.reserve(rows * STRIDE);
+        lengths.reserve(rows);
+        heads.reserve(rows);
+        goals.reserve(rows);
+        sums.reserve(rows);
+        goal_days.reserve(rows);
+    }
+
+    // Stores a week of steps (oldest first) and the daily goal in a new row and returns its slot.
+    uint32_t allocate(const vector<int>& weekly_steps, int daily_goal) {
+        return allocate(weekly_steps.data(), weekly_steps.size(), daily_goal);
+    }
+
+    uint32_t allocate(const int32_t* days, size_t count, int daily_goal) {
+        uint32_t slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(lengths.size());
+            lengths.push_back(0);
+            heads.push_back(0);
+            goals.push_back(0);
+            sums.push_back(0);
+            goal_days.push_back(0);
+            steps.resize(steps.size() + STRIDE, 0);
+        }
+        goals[slot] = daily_goal;
+        assign(slot, days, count);
+        return slot;
+    }
+
+    void release(uint32_t slot) {
+        if (slot >= lengths.size()) return;
+        lengths[slot] = 0;
+        heads[slot] = 0;
+        goals[slot] = 0;
+        sums[slot] = 0;
+        goal_days[slot] = 0;
+        fill_n(steps.begin() + slot * STRIDE, STRIDE, 0);
+        archive.release(slot);
+        free_slots.push_back(slot);
+    }
+
+    // Overwrites a row, keeping the most recent DAYS entries.
+    void assign(uint32_t slot, const vector<int>& weekly_steps) {
+        assign(slot, weekly_steps.data(), weekly_steps.size());
+    }
+
+    void assign(uint32_t slot, const int32_t* days, size_t count) {
+        size_t kept = min(count, DAYS);
+        int32_t* dst = &steps[slot * STRIDE];
+        copy(days + count - kept, days + count, dst);
+        fill(dst + kept, dst + STRIDE, 0);
+        lengths[slot] = static_cast<uint8_t>(kept);
+        heads[slot] = 0;
+        recount(slot);
+    }
+
+    void set_goal(uint32_t slot, int daily_goal) {
+        goals[slot] = daily_goal;
+        recount(slot);
+    }
+
+    // Starts a new day in a row with the given steps, evicting the oldest entry once the
+    // row is full. Returns the change in the row's sum.
+    long long push_day(uint32_t slot, int32_t value) {
+        if (lengths[slot] < DAYS) {
+            size_t lane = lengths[slot]++;
+            steps[slot * STRIDE + lane] = 0;
+            goal_days[slot] = static_cast<uint8_t>(goal_days[slot] + (0 >= goals[slot])); // A new lane starts out as a zero day
+            return replace_lane(slot, lane, value);
+        }
+        size_t lane = heads[slot];
+        heads[slot] = static_cast<uint8_t>((lane + 1) % DAYS);
+        return replace_lane(slot, lane, value);
+    }
+
+    // Archives a full row's oldest entry, which the next push_day evicts, as `oldest_day`.
+    void archive_oldest(uint32_t slot, int oldest_day) {
+        if (lengths[slot] == DAYS) archive.append(slot, oldest_day, day(slot, 0), goals[slot]);
+    }
+
+    // Archives `steps` as `day` of a row's history, counted against daily_goal (journal replay).
+    bool archive_day(uint32_t slot, int day, int32_t steps, int32_t daily_goal) {
+        return archive.append(slot, day, steps, daily_goal);
+    }
+
+    const StepSeries& history(uint32_t slot) const { return archive.series_of(slot); }
+    void set_history(uint32_t slot, StepSeries row) { archive.assign(slot, std::move(row)); }
+    StepSeries take_history(uint32_t slot) { return archive.take(slot); }
+
+    // Stats of a row's days within [first_day, last_day], archived and live, where the
+    // newest live entry is day `today`. Live days count against the current goal.
+    StepWindowStats window(uint32_t slot, int today, int first_day, int last_day) const {
+        size_t count = length(slot);
+        int live_first = today - static_cast<int>(count) + 1;
+        StepWindowStats stats = archive.window(slot, first_day, min(last_day, live_first - 1));
+        for (int d = max(first_day, live_first); d <= min(last_day, today); ++d) {
+            int32_t steps = day(slot, static_cast<size_t>(d - live_first));
+            stats.add_day(steps, steps >= goals[slot]);
+        }
+        return stats;
+    }
+
+    // Sets the entry `age` days before today (0 = today) and returns the change in the
+    // row's sum. An empty row takes today's entry as its first day; any other day must be
+    // one the row holds. Returns nullopt if it does not.
+    optional<long long> set_day(uint32_t slot, size_t age, int32_t value) {
+        size_t count = lengths[slot];
+        if (count == 0 && age == 0) return push_day(slot, value);
+        if (age >= count) return nullopt;
+        return replace_lane(slot, lane_of(slot, count - 1 - age), value);
+    }
+
+    size_t length(uint32_t slot) const { return slot < lengths.size() ? lengths[slot] : 0; }
+
+    // The valid entry `day` of a row, oldest first.
+    int32_t day(uint32_t slot, size_t day) const { return steps[slot * STRIDE + lane_of(slot, day)]; }
+
+    // Copies a row's valid entries, oldest first, to out (room for DAYS) and returns how many.
+    size_t copy_days(uint32_t slot, int32_t* out) const {
+        size_t count = length(slot);
+        for (size_t i = 0; i < count; ++i) out[i] = day(slot, i);
+        return count;
+    }
+
+    // Today's steps (the newest entry), or 0 if the row is empty.
+    int today(uint32_t slot) const {
+        size_t count = length(slot);
+        return count == 0 ? 0 : day(slot, count - 1);
+    }
+
+    // Sum of the valid entries of a row.
+    long long row_sum(uint32_t slot) const {
+        return slot < sums.size() ? sums[slot] : 0;
+    }
+
+    // Sum and goal-achievement count of one row.
+    StepRowStats analyze_slot(uint32_t slot) const {
+        StepRowStats stats;
+        if (slot < lengths.size()) {
+            stats.total_steps = sums[slot];
+            stats.days_met_goal = goal_days[slot];
+            stats.days = lengths[slot];
+        }
+        return stats;
+    }
+
+    // Reads the stats of rows [begin, end) in one linear sweep of the columns; out[i]
+    // receives row begin + i.
+    void analyze_range(size_t begin, size_t end, StepRowStats* out) const {
+        for (size_t slot = begin; slot < end; ++slot) {
+            out[slot - begin] = StepRowStats{sums[slot], goal_days[slot], lengths[slot]};
+        }
+    }
+
+    // Analyzes every row; out is resized to slot_count().
+    void analyze_all(vector<StepRowStats>& out) const {
+        out.resize(lengths.size());
+        if (!out.empty()) analyze_range(0, lengths.size(), out.data());
+    }
+};
+
+// --- Goal Suggestion Rules ---
+// The goal-update policy as a pure function of the stats of a window of days (the week,
+// or a longer stretch of history), so it can be run over the whole population (and in
+// parallel) without printing anything. Day counts are per 7 days, so over a week they
+// read as written.
+
+enum class GoalAdvice {
+    InsufficientData, // Fewer than 7 days recorded
+    Increase,         // Achieved 6+ days and averaged above 1.2x the goal
+    Keep,             // Achieved 6+ days without exceeding the goal by much
+    Decrease,         // Achieved at most 2 days and averaged below 0.8x the goal
+    Review,           // Achieved at most 2 days but averaged close to the goal
+    Mixed             // Achieved between those
+};
+
+struct GoalSuggestion {
+    int individual_id = 0;
+    GoalAdvice advice = GoalAdvice::InsufficientData;
+    int current_goal = 0;
+    int suggested_goal = 0;   // Equals current_goal unless the advice is Increase or Decrease
+    int achieved_days = 0;
+    double daily_average = 0; // Average daily steps over the recorded days
+
+    bool changes_goal() const { return suggested_goal != current_goal; }
+};
+
+inline GoalSuggestion decide_goal_update(int individual_id, int current_goal, const StepRowStats& window) {
+    GoalSuggestion result;
+    result.individual_id = individual_id;
+    result.current_goal = current_goal;
+    result.suggested_goal = current_goal;
+    if (window.days < 7) return result; // Not enough data for a meaningful suggestion
+
+    result.achieved_days = window.days_met_goal;
+    result.daily_average = static_cast<double>(window.total_steps) / window.days;
+    long long achieved_per_week = 7LL * result.achieved_days; // Compared against 7 * days, so a week is exact
+    if (achieved_per_week >= 6LL * window.days) { // Consistently achieving (6 or 7 days)
+        if (result.daily_average > current_goal * 1.2) { // Significantly exceeding the goal
+            result.advice = GoalAdvice::Increase;
+            result.suggested_goal = static_cast<int>(current_goal * 1.1); // Increase by 10%
+        } else {
+            result.advice = GoalAdvice::Keep;
+        }
+    } else if (achieved_per_week <= 2LL * window.days) { // Consistently missing (0, 1, or 2 days achieved)
+        if (result.daily_average < current_goal * 0.8) { // Significantly missing the goal
+            result.advice = GoalAdvice::Decrease;
+            result.suggested_goal = static_cast<int>(current_goal * 0.9); // Decrease by 10%
+        } else {
+            result.advice = GoalAdvice::Review;
+        }
+    } else {
+        result.advice = GoalAdvice::Mixed;
+    }
+    return result;
+}
+
+// --- Order-Statistic Tree ---
+// Randomized balanced BST (treap) whose nodes also store their subtree size, so besides
+// ordered insert/erase it answers "rank of key" and "first K keys" in O(log n) (+K).
+// Used to keep the group leaderboard ranked as totals change. Nodes come from a pool
+// owned by the tree.
+
+template <typename Key, typename Compare = less<Key>>
+class OrderStatisticTree {
+private:
+    struct Node;
+    struct NodeDeleter {
+        pmr::memory_resource* pool = nullptr;
+        void operator()(Node* node) const {
+            node->~Node();
+            pool->deallocate(node, sizeof(Node), alignof(Node));
+        }
+    };
+    using OwnedNode = unique_ptr<Node, NodeDeleter>;
+
+    struct Node {
+        Key key;
+        uint32_t priority;
+        size_t size = 1; // Number of keys in this subtree
+        OwnedNode left, right;
+
+        Node(Key key, uint32_t priority) : key(std::move(key)), priority(priority) {}
+    };
+
+    unique_ptr<pmr::unsynchronized_pool_resource> node_pool; // Declared before root: outlives the nodes
+    OwnedNode root;
+    Compare comp;
+    uint32_t seed = 2463534242u; // Deterministic priorities keep runs reproducible
+
+    uint32_t next_priority() { // xorshift32
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    OwnedNode new_node(Key key) {
+        void* memory = node_pool->allocate(sizeof(Node), alignof(Node));
+        return OwnedNode(new (memory) Node(std::move(key), next_priority()), NodeDeleter{node_pool.get()});
+    }
+
+    static size_t size_of(const OwnedNode& node) { return node ? node->size : 0; }
+    static void update(Node* node) { node->size = 1 + size_of(node->left) + size_of(node->right); }
+
+    // Splits t into the keys less than key (left) and the rest (right).
+    void split(OwnedNode t, const Key& key, OwnedNode& left, OwnedNode& right) {
+        if (!t) {
+            left.reset();
+            right.reset();
+        } else if (comp(t->key, key)) {
+            split(std::move(t->right), key, t->right, right);
+            update(t.get());
+            left = std::move(t);
+        } else {
+            split(std::move(t->left), key, left, t->left);
+            update(t.get());
+            right = std::move(t);
+        }
+    }
+
+    // Joins two treaps where every key in left is less than every key in right.
+    OwnedNode merge(OwnedNode left, OwnedNode right) {
+        if (!left) return right;
+        if (!right) return left;
+        if (left->priority > right->priority) {
+            left->right = merge(std::move(left->right), std::move(right));
+            update(left.get());
+            return left;
+        }
+        right->left = merge(std::move(left), std::move(right->left));
+        update(right.get());
+        return right;
+    }
+
+    void insert_into(OwnedNode& t, OwnedNode node) {
+        if (!t) {
+            t = std::move(node);
+        } else if (node->priority > t->priority) {
+            split(std::move(t), node->key, node->left, node->right);
+            update(node.get());
+            t = std::move(node);
+        } else {
+            OwnedNode& side = comp(node->key, t->key) ? t->left : t->right;
+            insert_into(side, std::move(node));
+            update(t.get());
+        }
+    }
+
+    bool erase_from(OwnedNode& t, const Key& key) {
+        if (!t) return false;
+        bool erased;
+        if (comp(key, t->key)) {
+            erased = erase_from(t->left, key);
+        } else if (comp(t->key, key)) {
+            erased = erase_from(t->right, key);
+        } else {
+            t = merge(std::move(t->left), std::move(t->right));
+            return true;
+        }
+        if (erased) update(t.get());
+        return erased;
+    }
+
+    static size_t fix_sizes(Node* node) {
+        if (!node) return 0;
+        node->size = 1 + fix_sizes(node->left.get()) + fix_sizes(node->right.get());
+        return node->size;
+    }
+
+    // In-order visit of at most limit keys; returns how many are still wanted.
+    template <typename Visitor>
+    static size_t visit_first(const Node* node, size_t limit, Visitor& visit) {
+        if (!node || limit == 0) return limit;
+        limit = visit_first(node->left.get(), limit, visit);
+        if (limit == 0) return 0;
+        visit(node->key);
+        return visit_first(node->right.get(), limit - 1, visit);
+    }
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit OrderStatisticTree(Compare c = Compare(), pmr::memory_resource* upstream = pmr::new_delete_resource())
+        : node_pool(make_unique<pmr::unsynchronized_pool_resource>(upstream)), comp(std::move(c)) {}
+
+    size_t size() const { return size_of(root); }
+    void clear() {
+        root.reset();
+        node_pool->release(); // Hand the pool's blocks back in one go
+    }
+
+    // Replaces the contents with keys that are already sorted and free of duplicates, in
+    // O(n): the treap is built directly as the Cartesian tree of the keys and their
+    // priorities, keeping the right spine on a stack.
+    void assign_sorted(vector<Key> keys) {
+        clear();
+        vector<Node*> spine;
+        for (Key& key : keys) {
+            OwnedNode node = new_node(std::move(key));
+            Node* added = node.get();
+            while (!spine.empty() && spine.back()->priority < added->priority) spine.pop_back();
+            if (spine.empty()) {
+                node->left = std::move(root);
+                root = std::move(node);
+            } else {
+                node->left = std::move(spine.back()->right);
+                spine.back()->right = std::move(node);
+            }
+            spine.push_back(added);
+        }
+        fix_sizes(root.get());
+    }
+
+    // Inserts key unless an equal key is already present.
+    bool insert(Key key) {
+        if (rank(key) != npos) return false;
+        insert_into(root, new_node(std::move(key)));
+        return true;
+    }
+
+    bool erase(const Key& key) {
+        return erase_from(root, key);
+    }
+
+    // Zero-based position of key in sorted order, or npos if it is not present.
+    size_t rank(const Key& key) const {
+        size_t before = 0;
+        const Node* node = root.get();
+        while (node) {
+            if (comp(key, node->key)) {
+                node = node->left.get();
+            } else if (comp(node->key, key)) {
+                before += size_of(node->left) + 1;
+                node = node->right.get();
+            } else {
+                return before + size_of(node->left);
+            }
+        }
+        return npos;
+    }
+
+    // Number of keys that sort before key, whether or not key itself is present.
+    size_t count_before(const Key& key) const {
+        size_t before = 0;
+        const Node* node = root.get();
+        while (node) {
+            if (comp(node->key, key)) {
+                before += size_of(node->left) + 1;
+                node = node->right.get();
+            } else {
+                node = node->left.get();
+            }
+        }
+        return before;
+    }
+
+    // Calls visit(key) for the first k keys in sorted order.
+    template <typename Visitor>
+    void for_each_first(size_t k, Visitor visit) const {
+        visit_first(root.get(), k, visit);
+    }
+};
+
+// --- Daily Top-K Tracker ---
+// Keeps today's goal achievers (today's steps, the last weekly entry, at or above the
+// daily goal) ranked by today's steps, highest first with ties by ID. The current top K
+// is cached, so "top K" and "rank of X within the top K" are O(1) between changes and an
+// update costs O(log N) plus an O(K) cache refresh only when it touches the top K.
+
+class DailyTopK {
+public:
+    using Key = pair<int, int>; // (today's steps, individual ID)
+
+private:
+    struct Order {
+        bool operator()(const Key& a, const Key& b) const {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        }
+    };
+
+    const StepStore& step_store; // Source of today's step counts
+    OrderStatisticTree<Key, Order> qualifiers;
+    size_t k;
+    mutable vector<Key> top;                   // Cached first k qualifiers
+    mutable unordered_map<int, size_t> top_rank; // Individual ID -> 0-based rank within top
+    mutable atomic<bool> dirty{true};
+    mutable mutex refresh_mutex; // Readers may refresh the cache concurrently
+
+    Key key_of(const Individual& individual) const {
+        return Key(step_store.today(individual.step_slot), individual.id);
+    }
+
+    // Rebuilds the cache if a mutation invalidated it. Concurrent readers are safe: only
+    // one rebuilds, and the cache is not touched again until the next (exclusive) mutation.
+    void refresh() const {
+        if (!dirty.load(memory_order_acquire)) return;
+        lock_guard<mutex> lock(refresh_mutex);
+        if (!dirty.load(memory_order_relaxed)) return;
+        top.clear();
+        top_rank.clear();
+        qualifiers.for_each_first(k, [&](const Key& key) {
+            top_rank[key.second] = top.size();
+            top.push_back(key);
+        });
+        dirty.store(false, memory_order_release);
+    }
+
+public:
+    explicit DailyTopK(const StepStore& step_store, size_t k = 3,
+                       pmr::memory_resource* upstream = pmr::new_delete_resource())
+        : step_store(step_store), qualifiers(Order(), upstream), k(k) {}
+
+    bool qualifies(const Individual& individual) const {
+        return step_store.length(individual.step_slot) > 0 &&
+               step_store.today(individual.step_slot) >= individual.daily_step_goal;
+    }
+
+    size_t capacity() const { return k; }
+    size_t qualifier_count() const { return qualifiers.size(); }
+
+    void set_capacity(size_t new_k) {
+        k = new_k;
+        dirty = true;
+    }
+
+    void clear() {
+        qualifiers.clear();
+        dirty = true;
+    }
+
+    // Replaces the qualifiers with those among the given individuals, in O(n log n) for the
+    // sort and O(n) for the tree.
+    template <typename Individuals>
+    void rebuild(const Individuals& individuals) {
+        vector<Key> keys;
+        for (const Individual& individual : individuals) {
+            if (qualifies(individual)) keys.push_back(key_of(individual));
+        }
+        sort(keys.begin(), keys.end(), Order());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+        qualifiers.assign_sorted(std::move(keys));
+        dirty = true;
+    }
+
+    // Registers an individual's current state (their StepStore row must be filled). Call
+    // remove() with the old state before changing an individual's steps or goal, and add()
+    // again afterwards.
+    void add(const Individual& individual) {
+        if (!qualifies(individual)) return;
+        Key key = key_of(individual);
+        qualifiers.insert(key);
+        if (!dirty && qualifiers.rank(key) < k) dirty = true;
+    }
+
+    void remove(const Individual& individual) {
+        if (!qualifies(individual)) return;
+        if (qualifiers.erase(key_of(individual)) && !dirty && top_rank.count(individual.id)) dirty = true;
+    }
+
+    // The current top K as (today's steps, ID), best first.
+    const vector<Key>& top_k() const {
+        refresh();
+        return top;
+    }
+
+    // The first n qualifiers; served from the cache when n <= K.
+    vector<Key> first(size_t n) const {
+        if (n <= k) {
+            refresh();
+            return vector<Key>(top.begin(), top.begin() + min(n, top.size()));
+        }
+        vector<Key> result;
+        qualifiers.for_each_first(n, [&](const Key& key) { result.push_back(key); });
+        return result;
+    }
+
+    // 1-based rank of an individual within the top K, or 0 if they are not in it.
+    size_t rank_in_top(int individual_id) const {
+        refresh();
+        auto it = top_rank.find(individual_id);
+        return it == top_rank.end() ? 0 : it->second + 1;
+    }
+};
+
+// --- CSV Parsing Helpers ---
+// Streaming CSV reading used by the loaders. Files are read in large blocks, lines and
+// fields are handed out as string_views into the block buffer, and numbers are parsed
+// with from_chars, so malformed rows are reported instead of thrown.
+
+class CsvBlockReader {
+private:
+    ifstream in;
+    vector<char> buffer;
+    size_t begin_pos = 0; // Start of the unread bytes in buffer
+    size_t end_pos = 0;   // End of the valid bytes in buffer
+    size_t line_no = 0;
+    bool exhausted = false;
+
+    // Moves the unread tail to the front of the buffer and reads the next block after it.
+    // The buffer doubles when a single line does not fit.
+    void refill() {
+        size_t leftover = end_pos - begin_pos;
+        if (begin_pos > 0) memmove(buffer.data(), buffer.data() + begin_pos, leftover);
+        begin_pos = 0;
+        end_pos = leftover;
+        if (end_pos == buffer.size()) buffer.resize(buffer.size() * 2);
+        in.read(buffer.data() + end_pos, buffer.size() - end_pos);
+        end_pos += static_cast<size_t>(in.gcount());
+        if (!in) exhausted = true;
+    }
+
+    bool take_line(size_t length, size_t skip, string_view& line) {
+        line = string_view(buffer.data() + begin_pos, length);
+        begin_pos += length + skip;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1); // Tolerate CRLF files
+        ++line_no;
+        return true;
+    }
+
+public:
+    explicit CsvBlockReader(const string& path, size_t block_size = 1 << 20)
+        : in(path, ios::binary), buffer(block_size) {}
+
+    bool is_open() const { return in.is_open(); }
+
+    // 1-based number of the line most recently returned by next_line.
+    size_t line_number() const { return line_no; }
+
+    // Returns the next line without its terminator. The view is valid until the next call.
+    bool next_line(string_view& line) {
+        for (;;) {
+            const char* start = buffer.data() + begin_pos;
+            const void* newline = memchr(start, '\n', end_pos - begin_pos);
+            if (newline) {
+                return take_line(static_cast<const char*>(newline) - start, 1, line);
+            }
+            if (exhausted) {
+                if (begin_pos == end_pos) return false;
+                return take_line(end_pos - begin_pos, 0, line); // Last line without a trailing newline
+            }
+            refill();
+        }
+    }
+};
+
+// Hands out the delimiter-separated fields of a row one at a time, without copying.
+class CsvFieldCursor {
+private:
+    string_view rest;
+    bool done;
+
+public:
+    explicit CsvFieldCursor(string_view row) : rest(row), done(row.empty()) {}
+
+    bool next(string_view& field, char delimiter = ',') {
+        if (done) return false;
+        size_t pos = rest.find(delimiter);
+        if (pos == string_view::npos) {
+            field = rest;
+            done = true;
+        } else {
+            field = rest.substr(0, pos);
+            rest.remove_prefix(pos + 1);
+        }
+        return true;
+    }
+
+    // The unconsumed remainder of the row.
+    string_view remainder() const { return done ? string_view() : rest; }
+};
+
+// CSV headers. Individuals files written before the Points column existed are still
+// accepted on import (their points start at 0).
+const char* const INDIVIDUALS_CSV_HEADER =
+    "ID,Name,Age,DailyStepGoal,Points,WeeklyStepCount1,WeeklyStepCount2,WeeklyStepCount3,WeeklyStepCount4,WeeklyStepCount5,WeeklyStepCount6,WeeklyStepCount7";
+const char* const GROUPS_CSV_HEADER = "GroupID,GroupName,MemberIDs,WeeklyGroupGoal";
+
+// Parses a whole field as a base-10 int, ignoring surrounding spaces. Returns false on
+// empty, non-numeric or out-of-range input.
+inline bool parse_csv_int(string_view field, int& value) {
+    while (!field.empty() && field.front() == ' ') field.remove_prefix(1);
+    while (!field.empty() && field.back() == ' ') field.remove_suffix(1);
+    if (field.empty()) return false;
+    auto result = from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == errc() && result.ptr == field.data() + field.size();
+}
+
+// --- Write-Ahead Journal ---
+// Mutations are appended to a journal file as physical record images instead of
+// rewriting the whole data set on every change. Pending records are written together
+// (group commit) once enough have accumulated or enough time has passed, and the app
+// periodically folds the journal back into the binary snapshot (compaction).
+// Records that are still pending when the process dies are lost; a policy of
+// commit_every_records = 1 writes every mutation before the mutator returns.
+// With background_writes, commits and compactions are handed to a writer thread instead,
+// so mutators never wait for the disk; wait_durable() waits for what was handed over.
+
+struct JournalPolicy {
+    size_t commit_every_records = 1;          // Write pending records once this many are buffered
+    chrono::milliseconds commit_interval{0};  // ...or once this long has passed since the last write (0 = off)
+    size_t compact_after_records = 1000;      // Rewrite the snapshot and truncate the journal after this many records
+    bool background_writes = false;           // Write commits and snapshots on a background thread
+};
+
+// A thread that runs write jobs one at a time in submission order, so a journal append
+// queued after a snapshot reaches the disk after it, as it would synchronously.
+class BackgroundWriter {
+private:
+    mutex queue_mutex;
+    condition_variable wake;     // Signalled when a job is queued or the writer stops
+    condition_variable finished; // Signalled when a job completes
+    deque<function<bool()>> jobs;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    size_t failures = 0; // Jobs that returned false since the last wait_idle()
+    bool stopping = false;
+    thread worker;
+
+    void run() {
+        unique_lock<mutex> lock(queue_mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return; // Stopping, and everything queued has been written
+            function<bool()> job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            bool ok = job();
+            lock.lock();
+            ++completed;
+            failures += !ok;
+            finished.notify_all();
+        }
+    }
+
+public:
+    BackgroundWriter() : worker([this] { run(); }) {}
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    // Runs the jobs still queued, then stops the thread.
+    ~BackgroundWriter() {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    // Queues job; it returns false if its write failed.
+    void submit(function<bool()> job) {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            jobs.push_back(std::move(job));
+            ++submitted;
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every job submitted so far has run. Returns false if any job failed
+    // since the previous call.
+    bool wait_idle() {
+        unique_lock<mutex> lock(queue_mutex);
+        uint64_t target = submitted;
+        finished.wait(lock, [&] { return completed >= target; });
+        bool ok = failures == 0;
+        failures = 0;
+        return ok;
+    }
+};
+
+class Journal {
+private:
+    string path;
+    JournalPolicy policy;
+    ofstream out;
+    string pending;                       // Buffered records, one per line
+    size_t pending_records = 0;
+    size_t records_since_compaction = 0;  // Committed and pending records not yet folded into the snapshot
+    chrono::steady_clock::time_point last_commit = chrono::steady_clock::now();
+    unique_ptr<BackgroundWriter> writer;  // Owns `out` while policy.background_writes is set
+
+    bool _write(const string& records) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::JournalCommit);
+        STEP_TRACKER_STAT_COUNT(bytes_written, records.size());
+        out.write(records.data(), records.size());
+        out.flush();
+        return static_cast<bool>(out);
+    }
+
+    bool _truncate() {
+        out.close();
+        out.open(path, ios::trunc);
+        return out.is_open();
+    }
+
+public:
+    Journal(string path, JournalPolicy policy) : path(std::move(path)), policy(policy) {
+        if (policy.background_writes) writer = make_unique<BackgroundWriter>();
+    }
+
+    ~Journal() {
+        commit(); // Do not drop buffered records on a clean shutdown
+        writer.reset(); // Finishes the queued writes while `out` is still open
+    }
+
+    const string& file() const { return path; }
+    bool background_writes() const { return writer != nullptr; }
+
+    void set_policy(const JournalPolicy& new_policy) {
+        if (new_policy.background_writes && !writer) {
+            writer = make_unique<BackgroundWriter>();
+        } else if (!new_policy.background_writes && writer) {
+            commit();
+            writer.reset(); // Drains it; `out` belongs to this thread again
+        }
+        policy = new_policy;
+    }
+
+    // Opens the journal for appending. existing_records are records already on disk
+    // (replayed at startup) that still count towards the next compaction.
+    void open(size_t existing_records) {
+        wait_durable(); // The writer may still hold the previous file
+        out.close();
+        out.open(path, ios::app);
+        if (!out.is_open()) {
+            cerr << "Error: Could not open journal file '" << path << "' for writing." << endl;
+        }
+        records_since_compaction = existing_records;
+    }
+
+    // Buffers one record; it reaches the file on the next commit().
+    void append(const string& record) {
+        pending += record;
+        pending += '\n';
+        ++pending_records;
+        ++records_since_compaction;
+    }
+
+    bool commit_due() const {
+        if (pending_records == 0) return false;
+        if (pending_records >= policy.commit_every_records) return true;
+        return policy.commit_interval.count() > 0 &&
+               chrono::steady_clock::now() - last_commit >= policy.commit_interval;
+    }
+
+    bool compaction_due() const {
+        return records_since_compaction >= policy.compact_after_records;
+    }
+
+    // Writes all pending records with a single append and flush, or hands them to the
+    // background writer.
+    void commit() {
+        if (pending_records == 0) return;
+        if (writer) {
+            writer->submit([this, records = std::move(pending)] { return _write(records); });
+            pending = string();
+        } else {
+            if (!out.is_open()) return;
+            _write(pending);
+            pending.clear();
+        }
+        pending_records = 0;
+        last_commit = chrono::steady_clock::now();
+    }
+
+    // Waits until everything already handed to the background writer has been written.
+    // Returns false if a background write failed since the last wait. Safe to call while
+    // another thread commits.
+    bool wait_written() {
+        return writer ? writer->wait_idle() : true;
+    }
+
+    // Commits pending records, then waits for them as wait_written() does.
+    bool wait_durable() {
+        commit();
+        return wait_written();
+    }
+
+    // Empties the journal after its contents have been written into a new snapshot.
+    void reset() {
+        if (writer) {
+            writer->submit([this] { return _truncate(); }); // After the appends already queued
+        } else {
+            _truncate();
+        }
+        pending.clear();
+        pending_records = 0;
+        records_since_compaction = 0;
+        last_commit = chrono::steady_clock::now();
+    }
+
+    // Background compaction: commits pending records, then queues save() (which writes a
+    // snapshot already captured by the caller) followed by the truncation, which is skipped
+    // if save() fails. Records appended from now on are queued after both.
+    void compact_in_background(function<bool()> save) {
+        commit();
+        records_since_compaction = 0;
+        writer->submit([this, save = std::move(save)] { return save() && _truncate(); });
+    }
+};
+
+// --- Binary Snapshot ---
+// The startup snapshot: a versioned file of fixed-width records that is mapped into
+// memory and read in place, instead of parsing text. Layout, in native byte order
+// (checked on open), every section 8-byte aligned:
+//   SnapshotHeader
+//   SnapshotIndividual[individual_count]     sorted by ID
+//   int32_t steps[individual_count][DAYS]    row i belongs to individual record i
+//   SnapshotGroup[group_count]               sorted by GroupKey (natural Group ID order)
+//   StepHistoryBlock[history_block_count]    each individual's blocks, in record order
+//   history bytes                            the blocks' encoded days, by offset and length
+//   int32_t memberships[individual_count]    group record each individual belongs to, or -1
+//   int64_t group_totals[group_count]        each group's total weekly steps
+//   uint32_t group_ranks[group_count]        group records in leaderboard order
+//   uint32_t daily_top[daily_top_count]      individual records ranked by today's steps
+//   string table                             names and Group IDs, by offset and length
+// The sorted record arrays double as the key index: lookups binary-search the mapped
+// arrays, so only the pages a lookup touches are read from disk. The last four sections
+// are derived from the records; they are stored so that nothing has to be recomputed
+// from every record before the snapshot can answer queries.
+
+#if defined(__unix__) || defined(__APPLE__)
+#define STEP_TRACKER_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'T', 'P', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 5;
+constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304; // Reads back differently on a foreign-endian machine
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t days_per_row;  // StepStore::DAYS of the writer
+    uint32_t max_members;   // Group::MAX_MEMBERS of the writer
+    uint64_t individual_count;
+    uint64_t group_count;
+    uint64_t individuals_offset;
+    uint64_t steps_offset;
+    uint64_t groups_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    int32_t current_day;    // Day number of every step row's newest entry
+    int32_t next_settle_day; // Days before it have had their daily rewards settled (0: none)
+    uint64_t history_blocks_offset;
+    uint64_t history_block_count;
+    uint64_t history_bytes_offset;
+    uint64_t history_bytes_size;
+    uint64_t memberships_offset;
+    uint64_t group_totals_offset;
+    uint64_t group_ranks_offset;
+    uint64_t daily_top_offset;
+    uint64_t daily_top_count;       // The first goal achievers of today that are listed
+    uint64_t daily_qualifier_count; // All goal achievers of today
+};
+
+struct SnapshotIndividual {
+    int32_t id;
+    int32_t age;
+    int32_t daily_step_goal;
+    int32_t points;
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t step_days; // Valid entries in the record's step row
+    uint32_t history_block_count; // The record's history is blocks [history_first_block, +count)
+    uint64_t history_first_block;
+};
+
+struct SnapshotGroup {
+    uint32_t id_offset;
+    uint32_t id_length;
+    uint32_t name_offset;
+    uint32_t name_length;
+    int32_t weekly_group_goal;
+    uint32_t member_count;
+    int32_t member_ids[Group::MAX_MEMBERS]; // Sorted; the first member_count are valid
+};
+
+static_assert(sizeof(SnapshotHeader) == 168 && sizeof(SnapshotIndividual) == 40 &&
+              sizeof(SnapshotGroup) == 24 + 4 * Group::MAX_MEMBERS,
+              "snapshot records must have no padding");
+
+// A complete snapshot captured in memory: an immutable image of the state at one moment,
+// which can be written out later (and on another thread) while the state moves on.
+struct SnapshotImage {
+    SnapshotHeader header{};
+    vector<SnapshotIndividual> individuals;
+    vector<int32_t> steps;
+    vector<SnapshotGroup> groups;
+    vector<StepHistoryBlock> history_blocks; // Byte offsets are into history_bytes
+    vector<uint8_t> history_bytes;
+    vector<int32_t> memberships;
+    vector<int64_t> group_totals;
+    vector<uint32_t> group_ranks;
+    vector<uint32_t> daily_top;
+    string strings;
+
+    // Writes the image under a temporary name and renames it over path, so a failed write
+    // leaves the previous snapshot intact (and a mapped previous snapshot stays readable).
+    // Returns false on failure.
+    bool write(const string& path) const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::SaveSnapshot);
+        string temp_file = path + ".tmp";
+        ofstream out(temp_file, ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            cerr << "Error: Could not open snapshot file '" << temp_file << "' for writing." << endl;
+            return false;
+        }
+        uint64_t position = 0;
+        auto write_at = [&](uint64_t offset, const void* data, size_t size) {
+            static const char padding[8] = {};
+            out.write(padding, static_cast<streamsize>(offset - position));
+            out.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+            position = offset + size;
+        };
+        write_at(0, &header, sizeof(header));
+        write_at(header.individuals_offset, individuals.data(), individuals.size() * sizeof(SnapshotIndividual));
+        write_at(header.steps_offset, steps.data(), steps.size() * sizeof(int32_t));
+        write_at(header.groups_offset, groups.data(), groups.size() * sizeof(SnapshotGroup));
+        write_at(header.history_blocks_offset, history_blocks.data(), history_blocks.size() * sizeof(StepHistoryBlock));
+        write_at(header.history_bytes_offset, history_bytes.data(), history_bytes.size());
+        write_at(header.memberships_offset, memberships.data(), memberships.size() * sizeof(int32_t));
+        write_at(header.group_totals_offset, group_totals.data(), group_totals.size() * sizeof(int64_t));
+        write_at(header.group_ranks_offset, group_ranks.data(), group_ranks.size() * sizeof(uint32_t));
+        write_at(header.daily_top_offset, daily_top.data(), daily_top.size() * sizeof(uint32_t));
+        write_at(header.strings_offset, strings.data(), strings.size());
+        STEP_TRACKER_STAT_COUNT(bytes_written, position);
+        out.close();
+        if (!out) {
+            cerr << "Error: Could not write snapshot file '" << temp_file << "'." << endl;
+            remove(temp_file.c_str());
+            return false;
+        }
+        if (rename(temp_file.c_str(), path.c_str()) != 0) {
+            remove(path.c_str()); // Platforms that do not rename over an existing file
+            if (rename(temp_file.c_str(), path.c_str()) != 0) {
+                cerr << "Error: Could not replace snapshot file '" << path << "'." << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// A read-only view of a whole file: memory-mapped where the platform supports it,
+// otherwise read into a buffer.
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    vector<char> buffer; // Fallback copy when the file is not mapped
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            bytes = other.bytes;
+            length = other.length;
+            mapped = other.mapped;
+            buffer = std::move(other.buffer);
+            other.bytes = nullptr;
+            other.length = 0;
+            other.mapped = false;
+        }
+        return *this;
+    }
+    ~MappedFile() { close(); }
+
+    // Returns false if the file cannot be opened.
+    bool open(const string& path) {
+        close();
+#ifdef STEP_TRACKER_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* memory = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory != MAP_FAILED) {
+                bytes = static_cast<const char*>(memory);
+                length = static_cast<size_t>(info.st_size);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+        if (mapped) return true;
+#endif
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) return false;
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+        return true;
+    }
+
+    void close() {
+#ifdef STEP_TRACKER_HAVE_MMAP
+        if (mapped) munmap(const_cast<char*>(bytes), length);
+#endif
+        bytes = nullptr;
+        length = 0;
+        mapped = false;
+        buffer.clear();
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Opens a snapshot file and serves lookups straight from the mapped records. Views
+// returned by the accessors stay valid while the reader is open (also after it is moved).
+// StepTrackerApp answers lookups through it until it first needs its own trees.
+class SnapshotReader {
+private:
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+    const SnapshotIndividual* individual_records = nullptr;
+    const int32_t* step_rows = nullptr;
+    const SnapshotGroup* group_records = nullptr;
+    const StepHistoryBlock* history_blocks = nullptr;
+    const uint8_t* history_bytes = nullptr;
+    const int32_t* memberships = nullptr;
+    const int64_t* group_totals = nullptr;
+    const uint32_t* group_ranks = nullptr;
+    const uint32_t* daily_top = nullptr;
+    const char* strings = nullptr;
+
+    // True if count records of record_size bytes at offset lie inside the file and are aligned.
+    bool section_fits(uint64_t offset, uint64_t count, size_t record_size) const {
+        if (offset % 8 != 0 || offset > file.size()) return false;
+        return count <= (file.size() - offset) / record_size;
+    }
+
+public:
+    // Maps and validates the file. Returns false if it is missing (error stays nullptr) or
+    // is not a snapshot this build can read (error points at a description).
+    bool open(const string& path, const char*& error) {
+        close();
+        error = nullptr;
+        if (!file.open(path)) return false;
+        const SnapshotHeader* h = reinterpret_cast<const SnapshotHeader*>(file.data());
+        if (file.size() < sizeof(SnapshotHeader) || memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            error = "not a snapshot file";
+        } else if (h->version != SNAPSHOT_VERSION) {
+            error = "unsupported snapshot version";
+        } else if (h->byte_order != SNAPSHOT_BYTE_ORDER) {
+            error = "snapshot written with a different byte order";
+        } else if (h->days_per_row != StepStore::DAYS || h->max_members != Group::MAX_MEMBERS) {
+            error = "snapshot written with a different record layout";
+        } else if (!section_fits(h->individuals_offset, h->individual_count, sizeof(SnapshotIndividual)) ||
+                   !section_fits(h->steps_offset, h->individual_count, StepStore::DAYS * sizeof(int32_t)) ||
+                   !section_fits(h->groups_offset, h->group_count, sizeof(SnapshotGroup)) ||
+                   !section_fits(h->history_blocks_offset, h->history_block_count, sizeof(StepHistoryBlock)) ||
+                   !section_fits(h->history_bytes_offset, h->history_bytes_size, 1) ||
+                   !section_fits(h->memberships_offset, h->individual_count, sizeof(int32_t)) ||
+                   !section_fits(h->group_totals_offset, h->group_count, sizeof(int64_t)) ||
+                   !section_fits(h->group_ranks_offset, h->group_count, sizeof(uint32_t)) ||
+                   !section_fits(h->daily_top_offset, h->daily_top_count, sizeof(uint32_t)) ||
+                   !section_fits(h->strings_offset, h->strings_size, 1)) {
+            error = "truncated snapshot file";
+        } else {
+            header = h;
+            individual_records = reinterpret_cast<const SnapshotIndividual*>(file.data() + h->individuals_offset);
+            step_rows = reinterpret_cast<const int32_t*>(file.data() + h->steps_offset);
+            group_records = reinterpret_cast<const SnapshotGroup*>(file.data() + h->groups_offset);
+            history_blocks = reinterpret_cast<const StepHistoryBlock*>(file.data() + h->history_blocks_offset);
+            history_bytes = reinterpret_cast<const uint8_t*>(file.data() + h->history_bytes_offset);
+            memberships = reinterpret_cast<const int32_t*>(file.data() + h->memberships_offset);
+            group_totals = reinterpret_cast<const int64_t*>(file.data() + h->group_totals_offset);
+            group_ranks = reinterpret_cast<const uint32_t*>(file.data() + h->group_ranks_offset);
+            daily_top = reinterpret_cast<const uint32_t*>(file.data() + h->daily_top_offset);
+            strings = file.data() + h->strings_offset;
+            return true;
+        }
+        close();
+        return false;
+    }
+
+    void close() {
+        file.close();
+        header = nullptr;
+        individual_records = nullptr;
+        step_rows = nullptr;
+        group_records = nullptr;
+        history_blocks = nullptr;
+        history_bytes = nullptr;
+        memberships = nullptr;
+        group_totals = nullptr;
+        group_ranks = nullptr;
+        daily_top = nullptr;
+        strings = nullptr;
+    }
+
+    bool is_open() const { return header != nullptr; }
+    size_t individual_count() const { return header ? header->individual_count : 0; }
+    size_t group_count() const { return header ? header->group_count : 0; }
+    int current_day() const { return header ? header->current_day : 0; }
+    int next_settle_day() const { return header ? header->next_settle_day : 0; }
+
+    const SnapshotIndividual* individuals_begin() const { return individual_records; }
+    const SnapshotIndividual* individuals_end() const { return individual_records + individual_count(); }
+    const SnapshotGroup* groups_begin() const { return group_records; }
+    const SnapshotGroup* groups_end() const { return group_records + group_count(); }
+
+    // A string from the string table; empty if the reference is out of bounds.
+    string_view string_at(uint32_t offset, uint32_t length) const {
+        if (offset > header->strings_size || length > header->strings_size - offset) return string_view();
+        return string_view(strings + offset, length);
+    }
+
+    string_view name_of(const SnapshotIndividual& record) const { return string_at(record.name_offset, record.name_length); }
+    string_view id_of(const SnapshotGroup& record) const { return string_at(record.id_offset, record.id_length); }
+    string_view name_of(const SnapshotGroup& record) const { return string_at(record.name_offset, record.name_length); }
+
+    // The valid entries of an individual's step row are steps_of(r)[0 .. step_days_of(r)).
+    const int32_t* steps_of(const SnapshotIndividual& record) const {
+        return step_rows + (&record - individual_records) * StepStore::DAYS;
+    }
+    size_t step_days_of(const SnapshotIndividual& record) const { return min<size_t>(record.step_days, StepStore::DAYS); }
+    // A copy of an individual's archived days. It ends before the first block whose
+    // reference is out of bounds, so a damaged record keeps the blocks before the damage.
+    StepSeries history_of(const SnapshotIndividual& record) const {
+        StepSeries series;
+        uint64_t first = record.history_first_block;
+        if (first > header->history_block_count || record.history_block_count > header->history_block_count - first) {
+            return series;
+        }
+        for (const StepHistoryBlock* block = history_blocks + first;
+             block != history_blocks + first + record.history_block_count; ++block) {
+            if (block->byte_offset > header->history_bytes_size ||
+                block->byte_length > header->history_bytes_size - block->byte_offset ||
+                (!series.empty() && block->first_day <= series.blocks.back().last_day())) {
+                break;
+            }
+            StepHistoryBlock copy = *block;
+            copy.byte_offset = series.bytes.size();
+            series.bytes.insert(series.bytes.end(), history_bytes + block->byte_offset,
+                                history_bytes + block->byte_offset + block->byte_length);
+            series.blocks.push_back(copy);
+        }
+        return series;
+    }
+
+    size_t member_count_of(const SnapshotGroup& record) const { return min<size_t>(record.member_count, Group::MAX_MEMBERS); }
+
+    // Today's steps (the newest entry of the step row), or 0 if the row is empty.
+    int today_of(const SnapshotIndividual& record) const {
+        size_t days = step_days_of(record);
+        return days == 0 ? 0 : steps_of(record)[days - 1];
+    }
+
+    // The derived sections. References out of bounds read as absent (no group, nullptr).
+    const SnapshotGroup* group_of(const SnapshotIndividual& record) const {
+        int32_t index = memberships[&record - individual_records];
+        return index >= 0 && static_cast<uint64_t>(index) < group_count() ? group_records + index : nullptr;
+    }
+    long long total_of(const SnapshotGroup& record) const { return group_totals[&record - group_records]; }
+
+    // The group at a 0-based leaderboard position.
+    const SnapshotGroup* ranked_group(size_t position) const {
+        if (position >= group_count() || group_ranks[position] >= group_count()) return nullptr;
+        return group_records + group_ranks[position];
+    }
+
+    // Number of groups that rank ahead of a group with this total and ID (leaderboard
+    // order: highest total first, ties by Group ID), whether or not that group is here.
+    size_t groups_ranked_ahead(long long total_weekly_steps, const GroupKey& key) const {
+        size_t first = 0, count = group_count();
+        while (count > 0) { // Binary search for the first position that does not rank ahead
+            size_t step = count / 2;
+            const SnapshotGroup* group = ranked_group(first + step);
+            if (group == nullptr) return 0;
+            long long total = total_of(*group);
+            bool ahead = total != total_weekly_steps ? total > total_weekly_steps : GroupKey(id_of(*group)) < key;
+            if (ahead) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    // Today's first daily_top_count() goal achievers, best first; daily_qualifier_count()
+    // is how many there are in all.
+    size_t daily_top_count() const { return header ? header->daily_top_count : 0; }
+    size_t daily_qualifier_count() const { return header ? header->daily_qualifier_count : 0; }
+    const SnapshotIndividual* daily_top_at(size_t position) const {
+        if (position >= daily_top_count() || daily_top[position] >= individual_count()) return nullptr;
+        return individual_records + daily_top[position];
+    }
+
+    // The record with this ID, or nullptr.
+    const SnapshotIndividual* find_individual(int id) const {
+        const SnapshotIndividual* it = lower_bound(individuals_begin(), individuals_end(), id,
+                                                   [](const SnapshotIndividual& r, int key) { return r.id < key; });
+        return it != individuals_end() && it->id == id ? it : nullptr;
+    }
+
+    // Records with IDs in [start_id, end_id], as a [first, last) pointer range.
+    pair<const SnapshotIndividual*, const SnapshotIndividual*> individuals_in(int start_id, int end_id) const {
+        const SnapshotIndividual* first = lower_bound(individuals_begin(), individuals_end(), start_id,
+                                                      [](const SnapshotIndividual& r, int key) { return r.id < key; });
+        const SnapshotIndividual* last = upper_bound(first, individuals_end(), end_id,
+                                                     [](int key, const SnapshotIndividual& r) { return key < r.id; });
+        return {first, max(first, last)};
+    }
+
+    const SnapshotGroup* find_group(string_view group_id) const {
+        const SnapshotGroup* it = lower_bound(groups_begin(), groups_end(), GroupKey(group_id),
+                                              [&](const SnapshotGroup& r, const GroupKey& key) { return GroupKey(id_of(r)) < key; });
+        return it != groups_end() && id_of(*it) == group_id ? it : nullptr;
+    }
+
+    pair<const SnapshotGroup*, const SnapshotGroup*> groups_in(string_view start_id, string_view end_id) const {
+        const SnapshotGroup* first = lower_bound(groups_begin(), groups_end(), GroupKey(start_id),
+                                                 [&](const SnapshotGroup& r, const GroupKey& key) { return GroupKey(id_of(r)) < key; });
+        const SnapshotGroup* last = upper_bound(first, groups_end(), GroupKey(end_id),
+                                                [&](const GroupKey& key, const SnapshotGroup& r) { return key < GroupKey(id_of(r)); });
+        return {first, max(first, last)};
+    }
+};
+
+// --- Work-Stealing Task Pool ---
+// A fixed set of worker threads, each with its own deque of tasks. parallel_for splits an
+// index range into fixed-size chunks and deals them out round-robin; a worker runs its own
+// chunks newest first and, when it runs dry, steals the oldest chunk of another worker.
+// The submitting thread works through chunks too until its job is finished, so concurrent
+// callers and small jobs never wait idle. Chunk boundaries depend only on the range and
+// the grain, never on the thread count, so parallel_reduce combines the same partial
+// results in the same order however many threads run it.
+
+class TaskPool {
+public:
+    static constexpr size_t DEFAULT_GRAIN = 4096; // Items per chunk
+
+private:
+    struct Job {
+        void (*run)(const void* fn, size_t begin, size_t end);
+        const void* fn;
+        atomic<size_t> remaining; // Chunks not yet finished
+#ifdef STEP_TRACKER_STATS
+        StatOp op; // The submitting thread's operation, charged for every chunk
+#endif
+    };
+    struct Task {
+        Job* job;
+        size_t begin, end;
+    };
+    struct Queue {
+        mutex queue_mutex;
+        deque<Task> tasks;
+    };
+
+    vector<unique_ptr<Queue>> queues; // One per worker
+    vector<thread> workers;
+    mutex wake_mutex;
+    condition_variable wake;
+    atomic<size_t> queued{0};     // Tasks waiting in any queue
+    atomic<size_t> next_queue{0}; // Round-robin start for submissions
+    bool stopping = false;
+
+    // Takes a task from the home queue (newest first) or steals one from another (oldest first).
+    bool pop(size_t home, Task& task) {
+        for (size_t i = 0; i < queues.size(); ++i) {
+            Queue& queue = *queues[(home + i) % queues.size()];
+            lock_guard<mutex> lock(queue.queue_mutex);
+            if (queue.tasks.empty()) continue;
+            if (i == 0) {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            } else {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            queued.fetch_sub(1, memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    static void execute(const Task& task) {
+#ifdef STEP_TRACKER_STATS
+        StatAttribution attribution(task.job->op);
+#endif
+        task.job->run(task.job->fn, task.begin, task.end);
+        task.job->remaining.fetch_sub(1, memory_order_acq_rel); // Last touch of the job
+    }
+
+    void worker_loop(size_t home) {
+        Task task;
+        for (;;) {
+            if (pop(home, task)) {
+                execute(task);
+                continue;
+            }
+            unique_lock<mutex> lock(wake_mutex);
+            wake.wait(lock, [&] { return stopping || queued.load(memory_order_relaxed) > 0; });
+            if (stopping) return;
+        }
+    }
+
+    void start(unsigned thread_count) {
+        if (thread_count == 0) thread_count = max(1u, thread::hardware_concurrency());
+        stopping = false;
+        for (unsigned i = 1; i < thread_count; ++i) { // The calling thread is the first of thread_count
+            queues.push_back(make_unique<Queue>());
+        }
+        for (size_t i = 0; i < queues.size(); ++i) {
+            workers.emplace_back(&TaskPool::worker_loop, this, i);
+        }
+    }
+
+    void stop() {
+        {
+            lock_guard<mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) worker.join();
+        workers.clear();
+        queues.clear();
+    }
+
+public:
+    // thread_count includes the calling thread; 0 means one per hardware thread.
+    explicit TaskPool(unsigned thread_count = 0) { start(thread_count); }
+    ~TaskPool() { stop(); }
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    unsigned thread_count() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Restarts the pool with a new number of threads. No job may be running.
+    void set_thread_count(unsigned thread_count) {
+        stop();
+        start(thread_count);
+    }
+
+    // Calls fn(begin, end) for consecutive chunks of at most `grain` indices covering
+    // [0, count), in parallel, and returns once all of them have finished.
+    template <typename Fn>
+    void parallel_for(size_t count, size_t grain, const Fn& fn) {
+        if (count == 0) return;
+        grain = max<size_t>(grain, 1);
+        size_t chunks = (count + grain - 1) / grain;
+        if (workers.empty() || chunks == 1) {
+            for (size_t begin = 0; begin < count; begin += grain) fn(begin, min(begin + grain, count));
+            return;
+        }
+
+        Job job;
+        job.run = [](const void* f, size_t begin, size_t end) { (*static_cast<const Fn*>(f))(begin, end); };
+        job.fn = &fn;
+        job.remaining.store(chunks, memory_order_relaxed);
+#ifdef STEP_TRACKER_STATS
+        job.op = thread_stat_block().current;
+#endif
+        size_t home = next_queue.fetch_add(1, memory_order_relaxed);
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            Queue& queue = *queues[(home + chunk) % queues.size()];
+            lock_guard<mutex> lock(queue.queue_mutex);
+            queue.tasks.push_back(Task{&job, chunk * grain, min((chunk + 1) * grain, count)});
+        }
+        queued.fetch_add(chunks, memory_order_relaxed);
+        {
+            lock_guard<mutex> lock(wake_mutex); // Pairs with the predicate check in worker_loop
+        }
+        wake.notify_all();
+
+        // Help out (with this job or any other) until every chunk of this job is done
+        Task task;
+        while (job.remaining.load(memory_order_acquire) > 0) {
+            if (pop(home % queues.size(), task)) {
+                execute(task);
+            } else {
+                this_thread::yield();
+            }
+        }
+    }
+
+    // Maps each chunk of [0, count) to a partial result with map(begin, end), then folds the
+    // partials in chunk order with combine(acc, partial), starting from init.
+    template <typename T, typename Map, typename Combine>
+    T parallel_reduce(size_t count, size_t grain, T init, const Map& map, const Combine& combine) {
+        grain = max<size_t>(grain, 1);
+        vector<T> partials((count + grain - 1) / grain);
+        parallel_for(count, grain, [&](size_t begin, size_t end) { partials[begin / grain] = map(begin, end); });
+        for (const T& partial : partials) init = combine(init, partial);
+        return init;
+    }
+};
+
+// --- Report Results and Rendering ---
+// Reports are computed into plain result structs; formatting is a separate step. A
+// ReportRenderer appends reports to one reusable buffer in the chosen format and writes
+// it out with a single flush. Text reproduces the interactive console output, CSV writes
+// a header row plus one row per entry, and JSON writes one object per report per line.
+// Quiet renders nothing, so batch jobs pay for the computation only.
+
+enum class OutputFormat { Text, Csv, Json, Quiet };
+
+struct DailyRankEntry {
+    size_t rank = 0; // 1-based
+    int individual_id = 0;
+    string name;
+    int steps = 0;   // Today's steps
+};
+
+struct LeaderboardEntry {
+    size_t rank = 0; // 1-based
+    string group_id;
+    string group_name;
+    long long total_weekly_steps = 0;
+};
+
+struct GroupAchievement {
+    string group_id;
+    string group_name;
+    int weekly_group_goal = 0;
+    long long total_weekly_steps = 0;
+
+    bool achieved() const { return total_weekly_steps >= weekly_group_goal; }
+};
+
+struct GroupRangeEntry {
+    size_t rank = 0; // 1-based rank within the range
+    string group_id;
+    string group_name;
+    int weekly_group_goal = 0;
+    long long total_weekly_steps = 0;
+    vector<pair<int, string>> members; // (ID, name) of the members that exist
+};
+
+// Report results shared with the query cache, so a cached report is returned without copying it
+using LeaderboardResult = shared_ptr<const vector<LeaderboardEntry>>;
+using GroupRangeResult = shared_ptr<const vector<GroupRangeEntry>>;
+
+inline const char* goal_advice_name(GoalAdvice advice) {
+    switch (advice) {
+        case GoalAdvice::Increase: return "increase";
+        case GoalAdvice::Keep: return "keep";
+        case GoalAdvice::Decrease: return "decrease";
+        case GoalAdvice::Review: return "review";
+        case GoalAdvice::Mixed: return "mixed";
+        default: return "insufficient_data";
+    }
+}
+
+class ReportRenderer {
+private:
+    OutputFormat format;
+    string buffer;
+
+    void put(string_view text) { buffer.append(text.data(), text.size()); }
+    void put(char c) { buffer.push_back(c); }
+    template <typename Int, enable_if_t<is_integral_v<Int>, int> = 0>
+    void put(Int value) {
+        char digits[24];
+        buffer.append(digits, to_chars(digits, digits + sizeof(digits), value).ptr);
+    }
+    void put(double value) {
+        char digits[32];
+        int length = snprintf(digits, sizeof(digits), "%.2f", value);
+        buffer.append(digits, static_cast<size_t>(max(length, 0)));
+    }
+
+    // Appends a line built from the parts, e.g. line("Rank ", 1, ": ", name).
+    template <typename... Parts>
+    void line(const Parts&... parts) {
+        (put(parts), ...);
+        put('\n');
+    }
+
+    // Quotes a CSV field only if it contains a delimiter, quote, or line break.
+    void put_csv(string_view field) {
+        if (field.find_first_of(",\"\r\n") == string_view::npos) return put(field);
+        put('"');
+        for (char c : field) {
+            if (c == '"') put('"');
+            put(c);
+        }
+        put('"');
+    }
+
+    void put_json(string_view text) {
+        put('"');
+        for (char c : text) {
+            switch (c) {
+                case '"': put("\\\""); break;
+                case '\\': put("\\\\"); break;
+                case '\n': put("\\n"); break;
+                case '\r': put("\\r"); break;
+                case '\t': put("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                        put(escaped);
+                    } else {
+                        put(c);
+                    }
+            }
+        }
+        put('"');
+    }
+
+public:
+    explicit ReportRenderer(OutputFormat format = OutputFormat::Text) : format(format) {}
+
+    OutputFormat get_format() const { return format; }
+    void set_format(OutputFormat new_format) { format = new_format; }
+    bool quiet() const { return format == OutputFormat::Quiet; }
+
+    // The rendered text so far; clear() empties it but keeps the capacity for reuse.
+    const string& str() const { return buffer; }
+    void clear() { buffer.clear(); }
+
+    // Writes everything rendered so far with a single write and flush.
+    void flush(ostream& os) {
+        if (buffer.empty()) return;
+        os.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        os.flush();
+        buffer.clear();
+    }
+
+    // Today's top goal achievers, as listed by get_top_3 (k is the list size in the title).
+    void top_individuals(size_t k, const vector<DailyRankEntry>& entries) {
+        switch (format) {
+            case OutputFormat::Quiet: return;
+            case OutputFormat::Text:
+                line("\n--- Top ", k, " Individuals (Daily Goal Achievers) ---");
+                if (entries.empty()) line("No individuals met their daily goal today.");
+                for (const DailyRankEntry& entry : entries) {
+                    line("Rank ", entry.rank, ": ", entry.name, " (ID: ", entry.individual_id, ") - Steps: ", entry.steps);
+                }
+                return;
+            case OutputFormat::Csv:
+                line("rank,id,name,steps");
+                for (const DailyRankEntry& entry : entries) {
+                    put(entry.rank); put(','); put(entry.individual_id); put(',');
+                    put_csv(entry.name); line(',', entry.steps);
+                }
+                return;
+            case OutputFormat::Json:
+                put("{\"report\":\"top_individuals\",\"entries\":[");
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    if (i) put(',');
+                    put("{\"rank\":"); put(entries[i].rank);
+                    put(",\"id\":"); put(entries[i].individual_id);
+                    put(",\"name\":"); put_json(entries[i].name);
+                    put(",\"steps\":"); put(entries[i].steps); put('}');
+                }
+                line("]}");
+                return;
+        }
+    }
+
+    // The group leaderboard, highest total first.
+    void leader_board(const vector<LeaderboardEntry>& entries) {
+        switch (format) {
+            case OutputFormat::Quiet: return;
+            case OutputFormat::Text:
+                line("\n--- Group Leaderboard ---");
+                if (entries.empty()) line("No groups available to generate a leaderboard.");
+                for (const LeaderboardEntry& entry : entries) {
+                    line("Rank ", entry.rank, ": Group '", entry.group_name, "' (ID: ", entry.group_id,
+                         ") - Total Weekly Steps: ", entry.total_weekly_steps);
+                }
+                return;
+            case OutputFormat::Csv:
+                line("rank,group_id,group_name,total_weekly_steps");
+                for (const LeaderboardEntry& entry : entries) {
+                    put(entry.rank); put(','); put_csv(entry.group_id); put(',');
+                    put_csv(entry.group_name); line(',', entry.total_weekly_steps);
+                }
+                return;
+            case OutputFormat::Json:
+                put("{\"report\":\"leader_board\",\"entries\":[");
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    if (i) put(',');
+                    put("{\"rank\":"); put(entries[i].rank);
+                    put(",\"group_id\":"); put_json(entries[i].group_id);
+                    put(",\"group_name\":"); put_json(entries[i].group_name);
+                    put(",\"total_weekly_steps\":"); put(entries[i].total_weekly_steps); put('}');
+                }
+                line("]}");
+                return;
+        }
+    }
+
+    void group_achievement(const GroupAchievement& result) {
+        switch (format) {
+            case OutputFormat::Quiet: return;
+            case OutputFormat::Text:
+                line("\n--- Group Achievement for '", result.group_name, "' (ID: ", result.group_id, ") ---");
+                line("Weekly Group Goal: ", result.weekly_group_goal, " steps");
+                line("Total Steps Completed by Group: ", result.total_weekly_steps, " steps");
+                if (result.achieved()) {
+                    line("Result: Congratulations! Group '", result.group_name, "' has achieved its weekly goal!");
+                } else {
+                    line("Result: Group '", result.group_name, "' has not yet achieved its weekly goal. Needs ",
+                         result.weekly_group_goal - result.total_weekly_steps, " more steps.");
+                }
+                return;
+            case OutputFormat::Csv:
+                line("group_id,group_name,weekly_group_goal,total_weekly_steps,achieved");
+                put_csv(result.group_id); put(','); put_csv(result.group_name);
+                line(',', result.weekly_group_goal, ',', result.total_weekly_steps, ',', result.achieved() ? "true" : "false");
+                return;
+            case OutputFormat::Json:
+                put("{\"report\":\"group_achievement\",\"group_id\":"); put_json(result.group_id);
+                put(",\"group_name\":"); put_json(result.group_name);
+                put(",\"weekly_group_goal\":"); put(result.weekly_group_goal);
+                put(",\"total_weekly_steps\":"); put(result.total_weekly_steps);
+                line(",\"achieved\":", result.achieved() ? "true" : "false", '}');
+                return;
+        }
+    }
+
+    // Groups in [start_group_id, end_group_id], ranked within the range, with their members.
+    void group_range(const string& start_group_id, const string& end_group_id, const vector<GroupRangeEntry>& entries) {
+        switch (format) {
+            case OutputFormat::Quiet: return;
+            case OutputFormat::Text:
+                line("\n--- Group Information in Range: ", start_group_id, " to ", end_group_id, " ---");
+                if (entries.empty()) line("No groups found in the specified range.");
+                for (const GroupRangeEntry& entry : entries) {
+                    line("\nRank ", entry.rank, " in Range:");
+                    line("  Group ID: ", entry.group_id);
+                    line("  Group Name: ", entry.group_name);
+                    line("  Weekly Group Goal: ", entry.weekly_group_goal);
+                    line("  Total Weekly Steps: ", entry.total_weekly_steps);
+                    put("  Members: ");
+                    if (entry.members.empty()) put("None");
+                    for (size_t j = 0; j < entry.members.size(); ++j) {
+                        if (j) put(", ");
+                        put(entry.members[j].second); put(" (ID: "); put(entry.members[j].first); put(')');
+                    }
+                    put('\n');
+                }
+                return;
+            case OutputFormat::Csv:
+                line("rank,group_id,group_name,weekly_group_goal,total_weekly_steps,member_ids");
+                for (const GroupRangeEntry& entry : entries) {
+                    put(entry.rank); put(','); put_csv(entry.group_id); put(','); put_csv(entry.group_name);
+                    put(','); put(entry.weekly_group_goal); put(','); put(entry.total_weekly_steps); put(',');
+                    for (size_t j = 0; j < entry.members.size(); ++j) {
+                        if (j) put(';');
+                        put(entry.members[j].first);
+                    }
+                    put('\n');
+                }
+                return;
+            case OutputFormat::Json:
+                put("{\"report\":\"group_range\",\"start\":"); put_json(start_group_id);
+                put(",\"end\":"); put_json(end_group_id); put(",\"entries\":[");
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    const GroupRangeEntry& entry = entries[i];
+                    if (i) put(',');
+                    put("{\"rank\":"); put(entry.rank);
+                    put(",\"group_id\":"); put_json(entry.group_id);
+                    put(",\"group_name\":"); put_json(entry.group_name);
+                    put(",\"weekly_group_goal\":"); put(entry.weekly_group_goal);
+                    put(",\"total_weekly_steps\":"); put(entry.total_weekly_steps);
+                    put(",\"members\":[");
+                    for (size_t j = 0; j < entry.members.size(); ++j) {
+                        if (j) put(',');
+                        put("{\"id\":"); put(entry.members[j].first);
+                        put(",\"name\":"); put_json(entry.members[j].second); put('}');
+                    }
+                    put("]}");
+                }
+                line("]}");
+                return;
+        }
+    }
+
+    // One individual's goal suggestion, as printed by suggest_goal_update.
+    void goal_suggestion(const string& name, const GoalSuggestion& suggestion) {
+        switch (format) {
+            case OutputFormat::Quiet: return;
+            case OutputFormat::Text: {
+                line("\n--- Goal Suggestion for ", name, " (ID: ", suggestion.individual_id, ") ---");
+                int current = suggestion.current_goal;
+                int suggested = suggestion.suggested_goal;
+                switch (suggestion.advice) {
+                    case GoalAdvice::InsufficientData:
+                        line("Not enough weekly data to provide a meaningful suggestion (need 7 days).");
+                        line("Current Daily Goal: ", current);
+                        return;
+                    case GoalAdvice::Increase:
+                        line("Current Daily Goal: ", current);
+                        line("You consistently achieve your daily goal and often exceed it! "
+                             "Consider increasing your daily goal to ", suggested, " steps to challenge yourself further.");
+                        break;
+                    case GoalAdvice::Keep:
+                        line("Current Daily Goal: ", current);
+                        line("You consistently achieve your daily goal. Keep up the great work! "
+                             "Current goal of ", current, " steps seems appropriate.");
+                        break;
+                    case GoalAdvice::Decrease:
+                        line("Current Daily Goal: ", current);
+                        line("You are consistently missing your daily goal. "
+                             "Consider lowering your daily goal to ", suggested, " steps to build consistency and confidence.");
+                        break;
+                    case GoalAdvice::Review:
+                        line("Current Daily Goal: ", current);
+                        line("You sometimes miss your daily goal. "
+                             "Review your activity patterns. Current goal of ", current, " steps "
+                             "might be achievable with slight adjustments.");
+                        break;
+                    case GoalAdvice::Mixed:
+                        line("Current Daily Goal: ", current);
+                        line("Your performance is mixed. Current goal of ", current, " steps "
+                             "is a good target. Focus on consistency.");
+                        break;
+                }
+                if (suggestion.changes_goal()) line("Suggested New Daily Goal: ", suggested);
+                return;
+            }
+            case OutputFormat::Csv:
+                line("id,name,advice,current_goal,suggested_goal,achieved_days,daily_average");
+                put(suggestion.individual_id); put(','); put_csv(name);
+                line(',', goal_advice_name(suggestion.advice), ',', suggestion.current_goal, ',', suggestion.suggested_goal,
+                     ',', suggestion.achieved_days, ',', suggestion.daily_average);
+                return;
+            case OutputFormat::Json:
+                put("{\"report\":\"goal_suggestion\",\"id\":"); put(suggestion.individual_id);
+                put(",\"name\":"); put_json(name);
+                put(",\"advice\":\""); put(goal_advice_name(suggestion.advice));
+                put("\",\"current_goal\":"); put(suggestion.current_goal);
+                put(",\"suggested_goal\":"); put(suggestion.suggested_goal);
+                put(",\"achieved_days\":"); put(suggestion.achieved_days);
+                line(",\"daily_average\":", suggestion.daily_average, '}');
+                return;
+        }
+    }
+};
+
+// --- Query Result Cache ---
+// Recent results of the read-only reports, keyed by operation and arguments. Each result
+// is stamped with the data version it was computed from; the app bumps the version on
+// every mutation of the data the report reads, so a stamped result can be returned
+// without recomputing it until that data changes. Results are shared, immutable vectors:
+// a hit hands out another reference instead of copying the rows. Memory is bounded by the total rows of
+// the cached results: the least recently used results are evicted first, and a result
+// larger than the whole capacity is not cached. The cache has its own mutex, so reports
+// running in parallel under the app's shared lock can fill and read it.
+
+// Counters reported by StepTrackerApp::query_cache_stats()
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;      // Lookups that found no result, or a stale one
+    uint64_t evictions = 0;   // Results evicted to stay within the capacity
+    size_t results = 0;       // Results cached now
+    size_t rows = 0;          // Rows of the cached results
+    size_t capacity_rows = 0;
+};
+
+class QueryCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY_ROWS = 65536;
+    using Result = variant<LeaderboardResult, GroupRangeResult>;
+
+private:
+    struct Entry {
+        string key;
+        uint64_t version;
+        Result result;
+        size_t rows;
+    };
+
+    mutable mutex cache_mutex;
+    list<Entry> entries; // Most recently used first
+    unordered_map<string_view, list<Entry>::iterator> index; // Keys view the entries' own keys
+    size_t capacity_rows;
+    size_t cached_rows = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    void erase(list<Entry>::iterator entry) {
+        cached_rows -= entry->rows;
+        index.erase(entry->key);
+        entries.erase(entry);
+    }
+
+    void evict_to(size_t rows) {
+        while (cached_rows > rows) {
+            erase(prev(entries.end()));
+            ++evictions;
+        }
+    }
+
+public:
+    explicit QueryCache(size_t capacity_rows = DEFAULT_CAPACITY_ROWS) : capacity_rows(capacity_rows) {}
+
+    // Changes the capacity, evicting as needed; 0 turns the cache off.
+    void set_capacity(size_t rows) {
+        lock_guard<mutex> lock(cache_mutex);
+        capacity_rows = rows;
+        evict_to(rows);
+    }
+
+    void clear() {
+        lock_guard<mutex> lock(cache_mutex);
+        entries.clear();
+        index.clear();
+        cached_rows = 0;
+    }
+
+    // The result cached under key if it was computed at version, or null, and marks it as
+    // recently used. A stale result is dropped.
+    template <typename T>
+    T find(const string& key, uint64_t version) {
+        lock_guard<mutex> lock(cache_mutex);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            ++misses;
+            return nullptr;
+        }
+        auto entry = it->second;
+        const T* result = get_if<T>(&entry->result);
+        if (entry->version != version || result == nullptr) {
+            erase(entry);
+            ++misses;
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, entry);
+        ++hits;
+        return *result;
+    }
+
+    // Caches a result computed at version under key, replacing any previous one.
+    template <typename T>
+    void insert(string key, uint64_t version, T result) {
+        size_t rows = max<size_t>(result->size(), 1); // An empty result still takes an entry
+        lock_guard<mutex> lock(cache_mutex);
+        auto it = index.find(key);
+        if (it != index.end()) erase(it->second);
+        if (rows > capacity_rows) return;
+        evict_to(capacity_rows - rows);
+        entries.push_front(Entry{std::move(key), version, Result(std::move(result)), rows});
+        index.emplace(entries.front().key, entries.begin());
+        cached_rows += rows;
+    }
+
+    QueryCacheStats stats() const {
+        lock_guard<mutex> lock(cache_mutex);
+        return QueryCacheStats{hits, misses, evictions, entries.size(), cached_rows, capacity_rows};
+    }
+};
+
+// --- Step Tracking Application Logic ---
+
+// Trees used by the application, keyed directly by the record's ID member
+using IndividualTree = ConceptualBPlusTree<Individual, int, MemberKey<Individual, int, &Individual::id>>;
+using GroupTree = ConceptualBPlusTree<Group, GroupKey, MemberKey<Group, GroupKey, &Group::key>>;
+
+// Leaderboard ordering: highest total first, ties broken by Group ID in natural order
+using GroupRankKey = pair<long long, GroupKey>;
+struct GroupRankOrder {
+    bool operator()(const GroupRankKey& a, const GroupRankKey& b) const {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    }
+};
+using GroupRankings = OrderStatisticTree<GroupRankKey, GroupRankOrder>;
+
+// Totals reported by StepTrackerApp::population_summary()
+struct PopulationSummary {
+    size_t individuals = 0;
+    long long individual_steps = 0; // Weekly steps of all individuals
+    long long goal_days = 0;        // Individual days at or above the daily goal
+    size_t daily_achievers = 0;     // Individuals who met today's goal
+    size_t groups = 0;
+    long long group_steps = 0;      // Sum of the group totals (grouped individuals only)
+    size_t groups_at_goal = 0;      // Groups whose total reached their weekly goal
+};
+
+// One device report for StepTrackerApp::record_steps_batch(): an individual's step total for a day
+struct StepRecord {
+    int individual_id;
+    int day;   // Day number on the app's day counter (see StepTrackerApp::current_day())
+    int steps;
+};
+
+// One merge for StepTrackerApp::merge_groups_many(): group_id_2 is merged into group_id_1
+struct GroupMerge {
+    string group_id_1;
+    string group_id_2;
+    string new_group_name;
+    int new_weekly_goal;
+};
+
+// A self-contained copy of one individual, taken by StepTrackerApp::export_individual() and
+// replayed by import_individual() to move them between apps
+struct IndividualImage {
+    int id = 0;
+    string name;
+    int age = 0;
+    int daily_step_goal = 0;
+    int points = 0;
+    vector<int> weekly_steps; // Oldest day first
+    StepSeries history;        // Days archived before weekly_steps
+    string group_id;           // Empty if un-grouped
+};
+
+// Mutation counters reported by StepTrackerApp::data_version(): each is bumped by every
+// change to its part of the data, so equal versions mean unchanged data
+struct DataVersion {
+    uint64_t individuals = 0; // Individual records, step rows and histories
+    uint64_t groups = 0;      // Group records, memberships and totals
+
+    // A stamp for data read from both parts: both counters only grow, so it changes
+    // whenever either does.
+    uint64_t combined() const { return individuals + groups; }
+};
+
+// Heap traffic reported by StepTrackerApp::allocation_stats()
+struct MemoryStats {
+    AllocationStats tree_nodes; // Blocks the trees' and rankings' node pools took from the heap
+    AllocationStats scratch;    // Per-query scratch that spilled past the inline buffers
+};
+
+// Concurrency: every public method takes the app's reader-writer lock. Reports and
+// queries share it, so any number run in parallel on a consistent view; mutators hold it
+// exclusively, so they are serialized and never overlap a report. Pointers and
+// references returned by queries are only safe to use until the next mutation starts;
+// use with_read_lock() to run several queries against one view.
+class StepTrackerApp {
+private:
+    using ReadLock = shared_lock<shared_mutex>;
+    using WriteLock = unique_lock<shared_mutex>;
+    mutable shared_mutex state_mutex; // Guards everything below
+
+    CountingResource tree_memory;            // Upstream of the trees' and rankings' node pools
+    mutable CountingResource scratch_memory; // Upstream of the per-query scratch arenas
+    IndividualTree individuals_tree{{}, {}, &tree_memory};
+    GroupTree groups_tree{{}, {}, &tree_memory};
+    GroupRankings group_rankings{{}, &tree_memory}; // Every group ranked by total_weekly_steps, kept in sync by the mutators
+    StepStore step_store;         // Columnar step history, one row per individual
+    StringArena names;            // Individual and group names
+    GroupIdInterner group_ids;    // Group ID <-> GroupHandle for individuals' memberships
+    DailyTopK daily_top{step_store, 3, &tree_memory}; // Today's goal achievers ranked by today's steps
+    int day_number = 0;           // Day number of today, every step row's newest entry
+    int next_settle_day = 0;      // Days before it have had their daily rewards settled (day numbers start at 0)
+    vector<int> reward_points{100, 75, 50}; // Points for daily ranks 1..K
+    atomic<OutputFormat> output_format{OutputFormat::Text}; // How the printing methods render
+    mutable TaskPool task_pool;   // Runs the population-wide aggregations in parallel
+    DataVersion version;          // Bumped wherever a mutation is journaled, and on every load
+    mutable QueryCache query_cache; // Leaderboard and range results, stamped with the versions they read
+    
+    string individuals_file; // Name of the CSV file for individuals (import/export)
+    string groups_file;      // Name of the CSV file for groups (import/export)
+    string snapshot_file;    // Binary snapshot loaded at startup and rewritten on compaction
+    SnapshotReader snapshot; // The loaded snapshot; names of its records view its string table
+    // While set, the snapshot is the whole state and the trees are still empty: lookups are
+    // answered from the mapped records, and _need_records() builds the trees on first use
+    mutable atomic<bool> records_mapped{false};
+    mutable mutex build_mutex; // Serializes that build when readers start it concurrently
+    Journal journal;         // Append-only log of mutations since the last snapshot
+    unique_ptr<StatsDumper> stats_dumper; // Periodic instrumentation output, if requested
+
+    // Parses one individuals CSV row: ID,Name,Age,DailyStepGoal,[Points,]Step1,...
+    // The steps go to weekly_steps, and the name is left viewing the row; _store_parsed
+    // moves both into the app. Returns nullopt and points error at a description for malformed rows.
+    static optional<Individual> _parse_individual_row(string_view row, bool has_points, vector<int>& weekly_steps,
+                                                      const char*& error) {
+        CsvFieldCursor fields(row);
+        string_view id_field, name_field, age_field, goal_field, points_field;
+        if (!fields.next(id_field) || !fields.next(name_field) || !fields.next(age_field) || !fields.next(goal_field) ||
+            (has_points && !fields.next(points_field))) {
+            error = "too few fields";
+            return nullopt;
+        }
+        int id, age, daily_goal, points = 0;
+        if (!parse_csv_int(id_field, id)) { error = "invalid ID"; return nullopt; }
+        if (!parse_csv_int(age_field, age)) { error = "invalid age"; return nullopt; }
+        if (!parse_csv_int(goal_field, daily_goal)) { error = "invalid daily step goal"; return nullopt; }
+        if (has_points && !parse_csv_int(points_field, points)) { error = "invalid points"; return nullopt; }
+
+        weekly_steps.clear();
+        string_view step_field;
+        // Parse weekly step counts (remaining fields of the line)
+        while (fields.next(step_field)) {
+            if (step_field.empty() && fields.remainder().empty()) break; // Trailing comma
+            int steps;
+            if (!parse_csv_int(step_field, steps)) { error = "invalid step count"; return nullopt; }
+            weekly_steps.push_back(steps);
+        }
+        if (weekly_steps.empty()) {
+            error = "too few fields";
+            return nullopt;
+        }
+        Individual individual(id, name_field, age, daily_goal);
+        individual.points = points;
+        return individual;
+    }
+
+    // Parses one groups CSV row: GroupID,GroupName,MemberID;MemberID;...,WeeklyGroupGoal
+    // The name is left viewing the row. Returns nullopt and points error at a description for malformed rows.
+    static optional<Group> _parse_group_row(string_view row, const char*& error) {
+        CsvFieldCursor fields(row);
+        string_view id_field, name_field, members_field, goal_field;
+        if (!fields.next(id_field) || !fields.next(name_field) || !fields.next(members_field) || !fields.next(goal_field)) {
+            error = "expected 4 fields";
+            return nullopt;
+        }
+        int weekly_group_goal;
+        if (!parse_csv_int(goal_field, weekly_group_goal)) { error = "invalid weekly group goal"; return nullopt; }
+
+        vector<int> member_ids;
+        member_ids.reserve(Group::MAX_MEMBERS + 1); // One allocation for valid rows
+        // Member IDs are semicolon-separated within a single CSV field
+        CsvFieldCursor members(members_field);
+        string_view mid_field;
+        while (members.next(mid_field, ';')) {
+            if (mid_field.empty()) continue; // Tolerate stray separators
+            int mid;
+            if (!parse_csv_int(mid_field, mid)) { error = "invalid member ID"; return nullopt; }
+            member_ids.push_back(mid);
+        }
+        sort(member_ids.begin(), member_ids.end());
+        if (unique(member_ids.begin(), member_ids.end()) - member_ids.begin() > Group::MAX_MEMBERS) {
+            error = "too many members";
+            return nullopt;
+        }
+        return Group(string(id_field), name_field, std::move(member_ids), weekly_group_goal);
+    }
+
+    // Writes one individual as a CSV row (without the trailing newline).
+    void _write_individual_row(ostream& os, const Individual& individual) const {
+        os << individual.id << "," << individual.name << "," << individual.age << ","
+           << individual.daily_step_goal << "," << individual.points;
+        for (size_t day = 0; day < step_store.length(individual.step_slot); ++day) {
+            os << "," << step_store.day(individual.step_slot, day); // Append each weekly step count
+        }
+    }
+
+    // Copies a parsed individual's name into the arena and its steps into a new step row.
+    void _store_parsed(Individual& individual, const vector<int>& weekly_steps) {
+        individual.name = names.store(individual.name);
+        individual.step_slot = step_store.allocate(weekly_steps, individual.daily_step_goal);
+    }
+
+    // Copies a group's name into the arena and interns its ID (parsed or newly created groups).
+    void _intern_group(Group& group) {
+        group.group_name = names.store(group.group_name);
+        group.handle = group_ids.intern(group.group_id);
+        group.key = group_ids.key_of(group.handle);
+    }
+
+    // Releases step rows that no individual in the tree refers to.
+    void _release_unowned_slots() {
+        vector<bool> owned(step_store.slot_count(), false);
+        for (const Individual& individual : individuals_tree) owned[individual.step_slot] = true;
+        for (uint32_t slot = 0; slot < owned.size(); ++slot) {
+            if (!owned[slot] && step_store.length(slot) > 0) step_store.release(slot);
+        }
+    }
+
+    // Removes an individual during loading, releasing their step row.
+    void _discard_loaded(int individual_id) {
+        const Individual* existing = individuals_tree.search(individual_id);
+        if (existing == nullptr) return;
+        step_store.release(existing->step_slot);
+        individuals_tree.remove(individual_id);
+    }
+
+    // Writes one group as a CSV row (without the trailing newline).
+    static void _write_group_row(ostream& os, const Group& group) {
+        os << group.group_id << "," << group.group_name << ",";
+        // Write member IDs, separated by semicolons
+        for (size_t i = 0; i < group.member_ids.size(); ++i) {
+            os << group.member_ids[i] << (i == group.member_ids.size() - 1 ? "" : ";");
+        }
+        os << "," << group.weekly_group_goal;
+    }
+
+    // Builds the trees from a mapped snapshot. Records are fixed-width and already in key
+    // order, so there is nothing to parse, and names keep viewing the snapshot's string table.
+    void _load_snapshot(const SnapshotReader& reader) {
+        vector<Individual> individuals;
+        individuals.reserve(reader.individual_count());
+        step_store.reserve(reader.individual_count());
+        for (const SnapshotIndividual* record = reader.individuals_begin(); record != reader.individuals_end(); ++record) {
+            Individual individual(record->id, reader.name_of(*record), record->age, record->daily_step_goal);
+            individual.points = record->points;
+            individual.step_slot = step_store.allocate(reader.steps_of(*record), reader.step_days_of(*record),
+                                                       record->daily_step_goal);
+            if (record->history_block_count > 0) step_store.set_history(individual.step_slot, reader.history_of(*record));
+            individuals.push_back(individual);
+        }
+        individuals_tree.bulk_load(std::move(individuals));
+        if (individuals_tree.size() < reader.individual_count()) _release_unowned_slots(); // Duplicate IDs were dropped
+
+        vector<Group> groups;
+        groups.reserve(reader.group_count());
+        for (const SnapshotGroup* record = reader.groups_begin(); record != reader.groups_end(); ++record) {
+            Group group(string(reader.id_of(*record)), reader.name_of(*record), {}, record->weekly_group_goal);
+            for (size_t i = 0; i < reader.member_count_of(*record); ++i) group.member_ids.push_back(record->member_ids[i]);
+            group.handle = group_ids.intern(group.group_id);
+            group.key = group_ids.key_of(group.handle);
+            groups.push_back(std::move(group));
+        }
+        groups_tree.bulk_load(std::move(groups));
+    }
+
+    // Takes memberships, group totals and the leaderboard ranking from the snapshot's derived
+    // sections instead of recomputing them from every record. Returns false, changing
+    // nothing, if they do not describe the loaded trees (records with duplicate keys were
+    // dropped, or the sections are out of order).
+    bool _load_derived(const SnapshotReader& reader) {
+        if (individuals_tree.size() != reader.individual_count() || groups_tree.size() != reader.group_count()) {
+            return false;
+        }
+        vector<GroupRankKey> ranks;
+        ranks.reserve(reader.group_count());
+        for (size_t position = 0; position < reader.group_count(); ++position) {
+            const SnapshotGroup* record = reader.ranked_group(position);
+            if (record == nullptr) return false;
+            ranks.emplace_back(reader.total_of(*record), GroupKey(reader.id_of(*record)));
+        }
+        if (adjacent_find(ranks.begin(), ranks.end(), [](const GroupRankKey& a, const GroupRankKey& b) {
+                return !GroupRankOrder()(a, b);
+            }) != ranks.end()) {
+            return false; // Not strictly in leaderboard order, so each group is listed once
+        }
+
+        // Trees and records are both in key order, so record i is the tree's i-th entry
+        vector<GroupHandle> handle_of_record;
+        handle_of_record.reserve(reader.group_count());
+        const SnapshotGroup* group_record = reader.groups_begin();
+        for (Group& group : groups_tree) {
+            group.total_weekly_steps = reader.total_of(*group_record++);
+            handle_of_record.push_back(group.handle);
+        }
+        const SnapshotIndividual* individual_record = reader.individuals_begin();
+        for (Individual& individual : individuals_tree) {
+            const SnapshotGroup* group = reader.group_of(*individual_record++);
+            individual.group = group ? handle_of_record[group - reader.groups_begin()] : NO_GROUP;
+        }
+        for (GroupRankKey& rank : ranks) rank.second = groups_tree.search(rank.second)->key; // View the interned IDs
+        group_rankings.assign_sorted(std::move(ranks));
+        return true;
+    }
+
+    // Builds the trees from the mapped snapshot if lookups are still answered from it. Every
+    // method that needs the trees calls it first, under either lock: until records_mapped is
+    // cleared, concurrent readers only read the snapshot, so one of them can build the trees
+    // while the others keep reading. Startup only maps the file; this is the linear part,
+    // paid by the first mutation or whole-population report instead (1M individuals: about
+    // 0.6 s), and with the derived sections it copies the records without recomputing anything
+    // but today's top-K.
+    void _need_records() const {
+        if (!records_mapped.load(memory_order_acquire)) return;
+        lock_guard<mutex> lock(build_mutex);
+        if (!records_mapped.load(memory_order_relaxed)) return;
+        // The trees are logically part of the state the snapshot already presents, so
+        // building them is not a mutation, even from a const query
+        StepTrackerApp& app = const_cast<StepTrackerApp&>(*this);
+        app._load_snapshot(snapshot);
+        if (!app._load_derived(snapshot)) app._derive_from_records();
+        app.daily_top.rebuild(individuals_tree);
+        records_mapped.store(false, memory_order_release);
+    }
+
+    // Recomputes memberships, group totals, the ranking and today's top-K from the records.
+    void _derive_from_records() {
+        // Membership is derived from the group records, so assign it once everything is loaded
+        _assign_group_memberships();
+        vector<GroupRankKey> ranks;
+        ranks.reserve(groups_tree.size());
+        for (const Group& group : groups_tree) ranks.emplace_back(group.total_weekly_steps, group.key);
+        sort(ranks.begin(), ranks.end(), GroupRankOrder());
+        group_rankings.assign_sorted(std::move(ranks));
+    }
+
+    // Lookups answered from the mapped snapshot while records_mapped is set; the caller
+    // holds the lock. They read only the snapshot, never the trees.
+
+    IndividualImage _snapshot_image(const SnapshotIndividual& record) const {
+        const int32_t* steps = snapshot.steps_of(record);
+        const SnapshotGroup* group = snapshot.group_of(record);
+        return IndividualImage{record.id, string(snapshot.name_of(record)), record.age, record.daily_step_goal,
+                               record.points, vector<int>(steps, steps + snapshot.step_days_of(record)),
+                               snapshot.history_of(record), group ? string(snapshot.id_of(*group)) : string()};
+    }
+
+    StepRowStats _snapshot_week_stats(const SnapshotIndividual& record) const {
+        StepRowStats stats;
+        const int32_t* steps = snapshot.steps_of(record);
+        stats.days = static_cast<int>(snapshot.step_days_of(record));
+        for (int day = 0; day < stats.days; ++day) {
+            stats.total_steps += steps[day];
+            stats.days_met_goal += steps[day] >= record.daily_step_goal;
+        }
+        return stats;
+    }
+
+    // group_range_info() over the snapshot's group records.
+    GroupRangeResult _snapshot_group_range(const string& start_group_id, const string& end_group_id) const {
+        auto [first, last] = snapshot.groups_in(start_group_id, end_group_id);
+        vector<const SnapshotGroup*> groups;
+        for (const SnapshotGroup* record = first; record != last; ++record) groups.push_back(record);
+        stable_sort(groups.begin(), groups.end(), [&](const SnapshotGroup* a, const SnapshotGroup* b) {
+            return snapshot.total_of(*a) > snapshot.total_of(*b);
+        });
+
+        auto entries = make_shared<vector<GroupRangeEntry>>();
+        entries->reserve(groups.size());
+        for (const SnapshotGroup* group : groups) {
+            GroupRangeEntry entry{entries->size() + 1, string(snapshot.id_of(*group)), string(snapshot.name_of(*group)),
+                                  group->weekly_group_goal, snapshot.total_of(*group), {}};
+            for (size_t i = 0; i < snapshot.member_count_of(*group); ++i) {
+                const SnapshotIndividual* member = snapshot.find_individual(group->member_ids[i]);
+                if (member) entry.members.emplace_back(member->id, string(snapshot.name_of(*member)));
+            }
+            entries->push_back(std::move(entry));
+        }
+        return entries;
+    }
+
+    // Today's first n goal achievers, or nullopt if the snapshot lists fewer of them.
+    optional<vector<const SnapshotIndividual*>> _snapshot_daily_top(size_t n) const {
+        size_t wanted = min(n, snapshot.daily_qualifier_count());
+        if (wanted > snapshot.daily_top_count()) return nullopt;
+        vector<const SnapshotIndividual*> top;
+        top.reserve(wanted);
+        for (size_t position = 0; position < wanted; ++position) {
+            const SnapshotIndividual* record = snapshot.daily_top_at(position);
+            if (record == nullptr) return nullopt;
+            top.push_back(record);
+        }
+        return top;
+    }
+
+    // 1-based rank within the top K, 0 if outside it, or nullopt if the snapshot lists too few.
+    optional<size_t> _snapshot_daily_rank(int individual_id) const {
+        optional<vector<const SnapshotIndividual*>> top = _snapshot_daily_top(daily_top.capacity());
+        if (!top) return nullopt;
+        for (size_t i = 0; i < top->size(); ++i) {
+            if ((*top)[i]->id == individual_id) return i + 1;
+        }
+        return 0;
+    }
+
+    // Loads the snapshot file if there is a readable one, otherwise imports the CSV files
+    // and writes a snapshot from them, then replays the journal on top. With from_csv the
+    // snapshot and any journal are ignored and the CSV files are the sole source. A snapshot
+    // with nothing to replay is only mapped: lookups read it in place until _need_records().
+    void _load_data(bool from_csv = false) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Load);
+        journal.wait_durable(); // A background compaction may still be writing the snapshot or journal
+        records_mapped.store(false, memory_order_relaxed); // The previous snapshot is about to close
+        step_store.clear();
+        names.clear();
+        group_ids.clear();
+        day_number = 0; // CSV data carries no date; a snapshot restores its own
+        next_settle_day = 0;
+        vector<int> weekly_steps; // Scratch row for the parser
+
+        SnapshotReader reader;
+        const char* error = nullptr;
+        bool have_snapshot = !from_csv && reader.open(snapshot_file, error);
+        if (error) {
+            cerr << "Warning: Ignoring snapshot file '" << snapshot_file << "' (" << error << "). Importing CSV files." << endl;
+        }
+        bool imported = false;
+        if (have_snapshot) {
+            day_number = reader.current_day();
+            next_settle_day = reader.next_settle_day();
+        } else {
+            imported = _import_csv(weekly_steps);
+        }
+        snapshot = std::move(reader); // Keeps the mapped names alive; closes the previous snapshot
+        records_mapped.store(have_snapshot, memory_order_relaxed);
+
+        size_t replayed = 0;
+        if (from_csv) {
+            journal.reset(); // Records in the journal were relative to the replaced state
+        } else {
+            replayed = _replay_journal(weekly_steps); // Builds the trees before the first record
+            journal.open(replayed);
+        }
+        if (!records_mapped.load(memory_order_relaxed)) {
+            _derive_from_records();
+            daily_top.rebuild(individuals_tree);
+        }
+        ++version.individuals; // Everything may have changed; cached results are stale
+        ++version.groups;
+        if (replayed > 0) {
+            _say("Loaded data. Individuals: ", individuals_tree.size(), ", Groups: ", groups_tree.size(),
+                 " (replayed ", replayed, " journal records)");
+        } else if (have_snapshot) {
+            _say("Loaded data. Individuals: ", snapshot.individual_count(), ", Groups: ", snapshot.group_count());
+        } else {
+            _say("Loaded data. Individuals: ", individuals_tree.size(), ", Groups: ", groups_tree.size());
+        }
+        // Imported CSV data becomes the snapshot, so the next start takes the fast path
+        if (imported && _save_snapshot()) journal.reset();
+    }
+
+    // Reads the individuals and groups CSV files into the trees. Returns false if neither exists.
+    bool _import_csv(vector<int>& weekly_steps) {
+        // Load Individuals from individuals.csv
+        CsvBlockReader ind_file(individuals_file);
+        if (!ind_file.is_open()) {
+            cerr << "Warning: Individuals CSV file '" << individuals_file << "' not found. Starting with empty individual data." << endl;
+            individuals_tree.bulk_load({});
+        } else {
+            vector<Individual> loaded;
+            string_view line;
+            ind_file.next_line(line); // Header line: tells whether the file has a Points column
+            bool has_points = line.find(",Points,") != string_view::npos;
+            while (ind_file.next_line(line)) { // Read each data line
+                if (line.empty()) continue;
+                const char* error = nullptr;
+                optional<Individual> individual = _parse_individual_row(line, has_points, weekly_steps, error);
+                if (!individual) {
+                    cerr << "Warning: Skipping malformed individual data line " << ind_file.line_number()
+                         << " (" << error << "): '" << line << "'" << endl;
+                    continue;
+                }
+                // Exports are in ID order, so step rows are allocated in tree order here
+                _store_parsed(*individual, weekly_steps);
+                loaded.push_back(std::move(*individual));
+            }
+            // Exports are written in ID order, so this is normally a linear bottom-up build
+            size_t parsed = loaded.size();
+            individuals_tree.bulk_load(std::move(loaded));
+            if (individuals_tree.size() < parsed) _release_unowned_slots(); // Duplicate IDs were dropped
+        }
+
+        // Load Groups from groups.csv
+        CsvBlockReader grp_file(groups_file);
+        if (!grp_file.is_open()) {
+            cerr << "Warning: Groups CSV file '" << groups_file << "' not found. Starting with empty group data." << endl;
+            groups_tree.bulk_load({});
+        } else {
+            vector<Group> loaded;
+            string_view line;
+            grp_file.next_line(line); // Skip header line
+            while (grp_file.next_line(line)) { // Read each data line
+                if (line.empty()) continue;
+                const char* error = nullptr;
+                optional<Group> group = _parse_group_row(line, error);
+                if (!group) {
+                    cerr << "Warning: Skipping malformed group data line " << grp_file.line_number()
+                         << " (" << error << "): '" << line << "'" << endl;
+                    continue;
+                }
+                _intern_group(*group);
+                loaded.push_back(std::move(*group));
+            }
+            groups_tree.bulk_load(std::move(loaded));
+        }
+        return ind_file.is_open() || grp_file.is_open();
+    }
+
+    // Re-applies journal records written since the last snapshot on top of the loaded data.
+    // Record formats: "I,<individual row>", "XI,<id>", "G,<group row>", "XG,<group id>",
+    // "S,<id>,<day>,<steps>" (one day's steps), "D,<day>" (day rollover),
+    // "H,<id>,<first day>,<goal>,<steps>;<steps>;..." (archived days) and "R,<day>" (daily
+    // rewards settled). Group totals
+    // and rankings are derived afterwards, so step records only touch the step rows.
+    // Returns the number of records applied.
+    size_t _replay_journal(vector<int>& weekly_steps) {
+        CsvBlockReader journal_file(journal.file());
+        if (!journal_file.is_open()) return 0; // No journal yet
+
+        size_t applied = 0;
+        string_view line;
+        while (journal_file.next_line(line)) {
+            if (line.empty()) continue;
+            if (records_mapped.load(memory_order_relaxed)) { // Records apply to the trees, so build them first
+                _load_snapshot(snapshot);
+                records_mapped.store(false, memory_order_relaxed);
+            }
+            CsvFieldCursor fields(line);
+            string_view type;
+            fields.next(type);
+            string_view payload = fields.remainder();
+            const char* error = "unknown record type";
+            bool ok = false;
+            if (type == "I") {
+                optional<Individual> individual = _parse_individual_row(payload, true, weekly_steps, error);
+                if (individual) {
+                    // Upsert: the record is the full new image, apart from the archived days
+                    const Individual* existing = individuals_tree.search(individual->id);
+                    StepSeries history = existing ? step_store.take_history(existing->step_slot) : StepSeries();
+                    _discard_loaded(individual->id);
+                    _store_parsed(*individual, weekly_steps);
+                    step_store.set_history(individual->step_slot, std::move(history));
+                    individuals_tree.insert(std::move(*individual));
+                    ok = true;
+                }
+            } else if (type == "XI") {
+                int individual_id;
+                error = "invalid ID";
+                if (parse_csv_int(payload, individual_id)) {
+                    _discard_loaded(individual_id);
+                    ok = true;
+                }
+            } else if (type == "G") {
+                optional<Group> group = _parse_group_row(payload, error);
+                if (group) {
+                    _intern_group(*group);
+                    groups_tree.remove(group->group_id);
+                    groups_tree.insert(std::move(*group));
+                    ok = true;
+                }
+            } else if (type == "XG") {
+                error = "missing group ID";
+                if (!payload.empty()) {
+                    groups_tree.remove(string(payload));
+                    ok = true;
+                }
+            } else if (type == "S") {
+                string_view id_field, day_field, steps_field;
+                int individual_id, day, steps;
+                error = "invalid step record";
+                if (fields.next(id_field) && fields.next(day_field) && fields.next(steps_field) &&
+                    parse_csv_int(id_field, individual_id) && parse_csv_int(day_field, day) &&
+                    parse_csv_int(steps_field, steps)) {
+                    const Individual* individual = individuals_tree.search(individual_id);
+                    long long age = static_cast<long long>(day_number) - day;
+                    error = "unknown individual or day";
+                    ok = individual != nullptr && age >= 0 && age < static_cast<long long>(StepStore::DAYS) &&
+                         step_store.set_day(individual->step_slot, static_cast<size_t>(age), steps);
+                }
+            } else if (type == "H") {
+                string_view id_field, day_field, goal_field, steps_field;
+                int individual_id, day, goal;
+                error = "invalid history record";
+                if (fields.next(id_field) && fields.next(day_field) && fields.next(goal_field) &&
+                    parse_csv_int(id_field, individual_id) && parse_csv_int(day_field, day) &&
+                    parse_csv_int(goal_field, goal)) {
+                    const Individual* individual = individuals_tree.search(individual_id);
+                    error = "unknown individual or day";
+                    ok = individual != nullptr;
+                    CsvFieldCursor days(fields.remainder());
+                    int steps;
+                    while (ok && days.next(steps_field, ';')) {
+                        ok = parse_csv_int(steps_field, steps) &&
+                             step_store.archive_day(individual->step_slot, day++, steps, goal);
+                    }
+                }
+            } else if (type == "R") {
+                int day;
+                error = "invalid day";
+                if (parse_csv_int(payload, day)) {
+                    next_settle_day = max(next_settle_day, day + 1);
+                    ok = true;
+                }
+            } else if (type == "D") {
+                int day;
+                error = "invalid day";
+                if (parse_csv_int(payload, day) && day >= day_number) {
+                    size_t days = _new_days_until(day);
+                    for (const Individual& individual : individuals_tree) _push_zero_days(individual.step_slot, days);
+                    day_number = day;
+                    ok = true;
+                }
+            }
+            if (!ok) {
+                cerr << "Warning: Skipping malformed journal record " << journal_file.line_number()
+                     << " (" << error << "): '" << line << "'" << endl;
+                continue;
+            }
+            ++applied;
+        }
+        return applied;
+    }
+
+    // Sets every individual's group from the group records and recomputes every
+    // group's total_weekly_steps. Memberships are collected and sorted by member ID, then
+    // merge-joined against individuals_tree in one in-order pass, instead of a scattered
+    // search per member. If an ID is listed by more than one group, the group that comes
+    // last in ID order wins.
+    void _assign_group_memberships() {
+        ScratchArena scratch(&scratch_memory);
+        pmr::vector<pair<int, Group*>> memberships(scratch.resource());
+        pmr::vector<Group*> groups(scratch.resource());
+        groups.reserve(groups_tree.size());
+        for (Group& group : groups_tree) {
+            groups.push_back(&group);
+            for (int member_id : group.member_ids) {
+                memberships.emplace_back(member_id, &group);
+            }
+        }
+        stable_sort(memberships.begin(), memberships.end(),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        auto membership = memberships.begin();
+        for (Individual& individual : individuals_tree) {
+            while (membership != memberships.end() && membership->first < individual.id) ++membership;
+            Group* group = nullptr;
+            for (; membership != memberships.end() && membership->first == individual.id; ++membership) {
+                group = membership->second;
+            }
+            if (group) {
+                individual.group = group->handle;
+            } else {
+                individual.group = NO_GROUP;
+            }
+        }
+
+        // Group totals are independent of each other, so sum them across the pool. Only
+        // members the join assigned to this group count towards it.
+        task_pool.parallel_for(groups.size(), TaskPool::DEFAULT_GRAIN / 8, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                Group& group = *groups[i];
+                long long total = 0;
+                for (int member_id : group.member_ids) {
+                    const Individual* individual = individuals_tree.search(member_id);
+                    if (individual && individual->group == group.handle) {
+                        total += step_store.row_sum(individual->step_slot);
+                    }
+                }
+                group.total_weekly_steps = total;
+            }
+        });
+    }
+
+    // Copies the current state into a snapshot image. Returns nullopt if it cannot be
+    // represented (the string table is limited to 4 GiB).
+    optional<SnapshotImage> _capture_snapshot() const {
+        SnapshotImage image;
+        string& strings = image.strings;
+        auto add_string = [&](string_view text, uint32_t& offset, uint32_t& length) {
+            offset = static_cast<uint32_t>(strings.size());
+            length = static_cast<uint32_t>(text.size());
+            strings.append(text.data(), text.size());
+        };
+
+        // Group records are written in tree order; memberships and ranks refer to them by position
+        vector<int32_t> record_of_handle(group_ids.size(), -1);
+        int32_t group_records = 0;
+        for (const Group& group : groups_tree) record_of_handle[group.handle] = group_records++;
+
+        vector<SnapshotIndividual>& individuals = image.individuals;
+        individuals.reserve(individuals_tree.size());
+        image.memberships.reserve(individuals_tree.size());
+        vector<int32_t>& steps = image.steps;
+        steps.assign(individuals_tree.size() * StepStore::DAYS, 0);
+        for (const Individual& individual : individuals_tree) { // Tree order is ID order
+            SnapshotIndividual record{};
+            record.id = individual.id;
+            record.age = individual.age;
+            record.daily_step_goal = individual.daily_step_goal;
+            record.points = individual.points;
+            add_string(individual.name, record.name_offset, record.name_length);
+            record.step_days = static_cast<uint32_t>(
+                step_store.copy_days(individual.step_slot, &steps[individuals.size() * StepStore::DAYS]));
+            const StepSeries& history = step_store.history(individual.step_slot);
+            record.history_first_block = image.history_blocks.size();
+            record.history_block_count = static_cast<uint32_t>(history.blocks.size());
+            for (StepHistoryBlock block : history.blocks) {
+                block.byte_offset += image.history_bytes.size();
+                image.history_blocks.push_back(block);
+            }
+            image.history_bytes.insert(image.history_bytes.end(), history.bytes.begin(), history.bytes.end());
+            individuals.push_back(record);
+            image.memberships.push_back(individual.group < record_of_handle.size() ? record_of_handle[individual.group] : -1);
+        }
+
+        vector<SnapshotGroup>& groups = image.groups;
+        groups.reserve(groups_tree.size());
+        for (const Group& group : groups_tree) {
+            SnapshotGroup record{};
+            add_string(group.group_id, record.id_offset, record.id_length);
+            add_string(group.group_name, record.name_offset, record.name_length);
+            record.weekly_group_goal = group.weekly_group_goal;
+            record.member_count = static_cast<uint32_t>(group.member_ids.size());
+            copy(group.member_ids.begin(), group.member_ids.end(), record.member_ids);
+            groups.push_back(record);
+            image.group_totals.push_back(group.total_weekly_steps);
+        }
+        image.group_ranks.reserve(groups.size());
+        group_rankings.for_each_first(SIZE_MAX, [&](const GroupRankKey& key) {
+            image.group_ranks.push_back(static_cast<uint32_t>(record_of_handle[groups_tree.search(key.second)->handle]));
+        });
+        for (const DailyTopK::Key& key : daily_top.first(daily_top.capacity())) {
+            auto record = lower_bound(individuals.begin(), individuals.end(), key.second,
+                                      [](const SnapshotIndividual& r, int id) { return r.id < id; });
+            image.daily_top.push_back(static_cast<uint32_t>(record - individuals.begin()));
+        }
+        if (strings.size() > UINT32_MAX) {
+            cerr << "Error: Snapshot string table exceeds 4 GiB." << endl;
+            return nullopt;
+        }
+
+        auto align8 = [](uint64_t offset) { return (offset + 7) & ~uint64_t(7); };
+        SnapshotHeader& header = image.header;
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.byte_order = SNAPSHOT_BYTE_ORDER;
+        header.days_per_row = StepStore::DAYS;
+        header.max_members = Group::MAX_MEMBERS;
+        header.individual_count = individuals.size();
+        header.group_count = groups.size();
+        header.individuals_offset = sizeof(SnapshotHeader);
+        header.steps_offset = align8(header.individuals_offset + individuals.size() * sizeof(SnapshotIndividual));
+        header.groups_offset = align8(header.steps_offset + steps.size() * sizeof(int32_t));
+        header.history_blocks_offset = align8(header.groups_offset + groups.size() * sizeof(SnapshotGroup));
+        header.history_block_count = image.history_blocks.size();
+        header.history_bytes_offset = align8(header.history_blocks_offset +
+                                             image.history_blocks.size() * sizeof(StepHistoryBlock));
+        header.history_bytes_size = image.history_bytes.size();
+        header.memberships_offset = align8(header.history_bytes_offset + image.history_bytes.size());
+        header.group_totals_offset = align8(header.memberships_offset + image.memberships.size() * sizeof(int32_t));
+        header.group_ranks_offset = align8(header.group_totals_offset + image.group_totals.size() * sizeof(int64_t));
+        header.daily_top_offset = align8(header.group_ranks_offset + image.group_ranks.size() * sizeof(uint32_t));
+        header.daily_top_count = image.daily_top.size();
+        header.daily_qualifier_count = daily_top.qualifier_count();
+        header.strings_offset = align8(header.daily_top_offset + image.daily_top.size() * sizeof(uint32_t));
+        header.strings_size = strings.size();
+        header.current_day = day_number;
+        header.next_settle_day = next_settle_day;
+        return image;
+    }
+
+    // Writes the current state as a binary snapshot. Returns false on failure.
+    bool _save_snapshot() const {
+        optional<SnapshotImage> image = _capture_snapshot();
+        return image && image->write(snapshot_file);
+    }
+
+    // Saves current individuals and groups data to the respective CSV files.
+    // Returns false if either file could not be written.
+    bool _export_csv() const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::ExportCsv);
+        // Save Individuals to individuals.csv
+        ofstream ind_file(individuals_file);
+        if (!ind_file.is_open()) {
+            cerr << "Error: Could not open individuals CSV file '" << individuals_file << "' for writing." << endl;
+            return false;
+        }
+        // Write header for individuals CSV
+        ind_file << INDIVIDUALS_CSV_HEADER << "\n";
+        // Iterate through all individuals in the tree and write their data
+        for (const auto& individual : individuals_tree) {
+            _write_individual_row(ind_file, individual);
+            ind_file << "\n"; // New line for the next individual
+        }
+        STEP_TRACKER_STAT_COUNT(bytes_written, static_cast<uint64_t>(ind_file.tellp()));
+        ind_file.close();
+
+        // Save Groups to groups.csv
+        ofstream grp_file(groups_file);
+        if (!grp_file.is_open()) {
+            cerr << "Error: Could not open groups CSV file '" << groups_file << "' for writing." << endl;
+            return false;
+        }
+        // Write header for groups CSV
+        grp_file << GROUPS_CSV_HEADER << "\n";
+        // Iterate through all groups in the tree and write their data
+        for (const auto& group : groups_tree) {
+            _write_group_row(grp_file, group);
+            grp_file << "\n";
+        }
+        STEP_TRACKER_STAT_COUNT(bytes_written, static_cast<uint64_t>(grp_file.tellp()));
+        grp_file.close();
+        _say("Data exported to CSV files.");
+        return true;
+    }
+
+    // The group an individual belongs to, or nullptr.
+    Group* _group_of(const Individual& individual) {
+        if (individual.group == NO_GROUP) return nullptr;
+        return groups_tree.search(group_ids.key_of(individual.group));
+    }
+
+    // The listed members that actually belong to the group. A listed ID can name an individual
+    // that was since deleted, re-added or moved to another group.
+    Group::MemberList _members_of(const Group& group) const {
+        Group::MemberList members;
+        for (int member_id : group.member_ids) {
+            const Individual* individual = individuals_tree.search(member_id);
+            if (individual && individual->group == group.handle) members.push_back(member_id);
+        }
+        return members;
+    }
+
+    // Sum of the weekly steps of the group's actual members, used to seed its total.
+    long long _sum_member_steps(const Group& group) {
+        long long total = 0;
+        for (int member_id : _members_of(group)) {
+            Individual* individual = individuals_tree.search(member_id);
+            total += step_store.row_sum(individual->step_slot);
+        }
+        return total;
+    }
+
+    void _rank_group(const Group& group) {
+        group_rankings.insert(GroupRankKey(group.total_weekly_steps, group.key));
+    }
+
+    void _unrank_group(const Group& group) {
+        group_rankings.erase(GroupRankKey(group.total_weekly_steps, group.key));
+    }
+
+    // Changes a group's total and moves it to its new leaderboard position.
+    void _adjust_group_total(Group& group, long long delta) {
+        if (delta == 0) return;
+        _unrank_group(group);
+        group.total_weekly_steps += delta;
+        _rank_group(group);
+        ++version.groups;
+    }
+
+    // How many zero days moving today to `day` appends to each row: one per day, but never
+    // more than a week, after which the window is all zeros anyway.
+    size_t _new_days_until(int day) const {
+        return static_cast<size_t>(min<long long>(static_cast<long long>(day) - day_number, StepStore::DAYS));
+    }
+
+    // Appends `days` zero days to a row (before day_number moves) and returns the change in
+    // its sum. The entries they evict, oldest first from the week ending at day_number, are
+    // archived into the row's history first.
+    long long _push_zero_days(uint32_t slot, size_t days) {
+        long long delta = 0;
+        int oldest_day = day_number - static_cast<int>(StepStore::DAYS) + 1;
+        for (size_t i = 0; i < days; ++i) {
+            step_store.archive_oldest(slot, oldest_day + static_cast<int>(i));
+            delta += step_store.push_day(slot, 0);
+        }
+        return delta;
+    }
+
+    // Moves today forward to `day` (a later day number). Every row rolls forward in O(1):
+    // the new days start at zero and evict the oldest entries, each group total moves by
+    // its members' evicted steps, and since today's counts restart at zero the top-K
+    // is refilled from the same pass (only goals of zero qualify).
+    void _advance_to_day(int day) {
+        size_t days = _new_days_until(day);
+        ScratchArena scratch(&scratch_memory);
+        pmr::vector<long long> group_deltas(group_ids.size(), 0, scratch.resource()); // By GroupHandle
+        daily_top.clear();
+        for (Individual& individual : individuals_tree) {
+            long long delta = _push_zero_days(individual.step_slot, days);
+            if (individual.group != NO_GROUP) group_deltas[individual.group] += delta;
+            daily_top.add(individual);
+        }
+        for (Group& group : groups_tree) _adjust_group_total(group, group_deltas[group.handle]);
+        day_number = day;
+        ++version.individuals;
+        journal.append("D," + to_string(day));
+    }
+
+    // Applies one device report: rolls the week forward first if it is for a later day,
+    // then replaces that day's count and moves the group total and today's ranking by the
+    // difference. Returns false and points error at a description if it cannot be applied.
+    bool _record_steps(const StepRecord& record, const char*& error) {
+        if (record.steps < 0) { error = "negative step count"; return false; }
+        Individual* individual = individuals_tree.search(record.individual_id);
+        if (individual == nullptr) { error = "individual not found"; return false; }
+        if (record.day > day_number) _advance_to_day(record.day);
+        long long age = static_cast<long long>(day_number) - record.day;
+        if (age >= static_cast<long long>(StepStore::DAYS)) { error = "day is before the recorded week"; return false; }
+
+        bool today = age == 0;
+        if (today) daily_top.remove(*individual);
+        optional<long long> delta = step_store.set_day(individual->step_slot, static_cast<size_t>(age), record.steps);
+        if (today) daily_top.add(*individual);
+        if (!delta) { error = "day is before the individual's first recorded day"; return false; }
+        if (*delta != 0) {
+            Group* group = _group_of(*individual);
+            if (group) _adjust_group_total(*group, *delta);
+        }
+        ++version.individuals;
+        journal.append("S," + to_string(record.individual_id) + "," + to_string(record.day) + "," +
+                       to_string(record.steps));
+        return true;
+    }
+
+    // Prints the individual's daily rank and the points it earns. Points are only awarded by
+    // settle_daily_rewards, so this reports what today's settlement awards (or awarded, once
+    // the day is settled) and changes nothing.
+    // The caller holds the lock.
+    void _report_individual_reward(int individual_id) const {
+        string_view name;
+        int points = 0;
+        optional<size_t> rank;
+        if (records_mapped.load(memory_order_acquire)) {
+            const SnapshotIndividual* record = snapshot.find_individual(individual_id);
+            if (record == nullptr) {
+                _say("Error: Individual with ID ", individual_id, " not found.");
+                return;
+            }
+            name = snapshot.name_of(*record);
+            points = record->points;
+            rank = _snapshot_daily_rank(individual_id);
+            if (!rank) _need_records(); // The snapshot lists too few of today's achievers
+        }
+        if (!rank) {
+            const Individual* individual = individuals_tree.search(individual_id); // Find the individual
+            if (individual == nullptr) {
+                _say("Error: Individual with ID ", individual_id, " not found.");
+                return;
+            }
+            name = individual->name;
+            points = individual->points;
+            rank = daily_top.rank_in_top(individual_id);
+        }
+        bool settled = day_number < next_settle_day;
+
+        _say("\n--- Rewards for ", name, " (ID: ", individual_id, ") ---");
+        if (*rank == 0 || *rank > reward_points.size()) {
+            _say("This individual is not in the top ", reward_points.size(), " daily goal achievers today.");
+        } else if (settled) {
+            _say("Congratulations! You are Rank ", *rank, " and earned ", reward_points[*rank - 1], " points today!");
+        } else {
+            _say("You are Rank ", *rank, " and will earn ", reward_points[*rank - 1], " points when today's rewards are settled.");
+        }
+        _say("Total points: ", points);
+    }
+
+    // Stats of an individual's last window_days days. The week is read from the row's
+    // running stats; longer windows also read the archived history.
+    StepRowStats _recent_stats(const Individual& individual, int window_days) const {
+        if (window_days == static_cast<int>(StepStore::DAYS)) return step_store.analyze_slot(individual.step_slot);
+        return step_store.window(individual.step_slot, day_number, day_number - window_days + 1, day_number).row_stats();
+    }
+
+    // Journals the current image of an individual.
+    void _log_individual(const Individual& individual) {
+        ostringstream record;
+        record << "I,";
+        _write_individual_row(record, individual);
+        ++version.individuals;
+        journal.append(record.str());
+    }
+
+    // Journals an individual's archived days, one record per block, for histories that did
+    // not arise from the journaled rollovers (individuals moved in from another app).
+    void _log_history(const Individual& individual) {
+        const StepSeries& history = step_store.history(individual.step_slot);
+        ++version.individuals;
+        vector<int32_t> days;
+        for (const StepHistoryBlock& block : history.blocks) {
+            StepHistory::decode(history, block, days);
+            string record = "H," + to_string(individual.id) + "," + to_string(block.first_day) + "," +
+                            to_string(block.daily_goal) + ",";
+            for (size_t i = 0; i < days.size(); ++i) {
+                if (i > 0) record += ';';
+                record += to_string(days[i]);
+            }
+            journal.append(record);
+        }
+    }
+
+    void _log_individual_deleted(int individual_id) {
+        ++version.individuals;
+        journal.append("XI," + to_string(individual_id));
+    }
+
+    // Journals the current image of a group.
+    void _log_group(const Group& group) {
+        ostringstream record;
+        record << "G,";
+        _write_group_row(record, group);
+        ++version.groups;
+        journal.append(record.str());
+    }
+
+    void _log_group_deleted(const string& group_id) {
+        ++version.groups;
+        journal.append("XG," + group_id);
+    }
+
+    // Writes one status or error line of the interactive output. The other formats carry
+    // only report data, and their callers rely on the return values instead.
+    template <typename... Parts>
+    void _say(const Parts&... parts) const {
+        if (output_format.load(memory_order_relaxed) != OutputFormat::Text) return;
+        (cout << ... << parts) << '\n';
+    }
+
+    // Renders a report with fn(renderer) into this thread's reusable buffer and flushes it
+    // once. Skipped entirely in quiet mode.
+    template <typename Fn>
+    void _render(Fn&& fn) const {
+        OutputFormat format = output_format.load(memory_order_relaxed);
+        if (format == OutputFormat::Quiet) return;
+        STEP_TRACKER_STAT_SCOPE(StatOp::Render);
+        static thread_local ReportRenderer renderer;
+        renderer.set_format(format);
+        fn(renderer);
+        renderer.flush(cout);
+    }
+
+    // Lock-free bodies of queries that other public methods reuse; the caller holds the lock.
+    vector<Individual*> _top_individuals(size_t k) {
+        vector<Individual*> result;
+        for (const DailyTopK::Key& key : daily_top.first(k)) {
+            result.push_back(individuals_tree.search(key.second));
+        }
+        return result;
+    }
+
+    vector<DailyRankEntry> _daily_leaders(const vector<Individual*>& ranked) const {
+        vector<DailyRankEntry> entries;
+        entries.reserve(ranked.size());
+        for (const Individual* individual : ranked) {
+            entries.push_back({entries.size() + 1, individual->id, string(individual->name), step_store.today(individual->step_slot)});
+        }
+        return entries;
+    }
+
+    vector<Group*> _top_groups(size_t k) {
+        vector<Group*> result;
+        result.reserve(min(k, group_rankings.size()));
+        group_rankings.for_each_first(k, [&](const GroupRankKey& key) {
+            result.push_back(groups_tree.search(key.second));
+        });
+        return result;
+    }
+
+    // Deletes a group but keeps its members, who become un-grouped. Caller holds the write lock.
+    bool _delete_group(const string& group_id) {
+        Group* group = groups_tree.search(group_id); // Find the group
+        if (group == nullptr) {
+            _say("Error: Group with ID ", group_id, " not found.");
+            return false;
+        }
+
+        // Un-group all members of this group (a listed ID may belong to another group)
+        for (int member_id : group->member_ids) {
+            Individual* individual = individuals_tree.search(member_id);
+            if (individual && individual->group == group->handle) {
+                individual->group = NO_GROUP; // Un-group the individual
+                _say("Individual ", individual->name, " (ID: ", member_id, ") is now un-grouped.");
+            }
+        }
+
+        // Delete group from the groups tree (copy the name first: removal invalidates the pointer)
+        string group_name(group->group_name);
+        _unrank_group(*group);
+        if (groups_tree.remove(group_id)) {
+            _log_group_deleted(group_id);
+            _commit(); // Persist the change
+            _say("Group '", group_name, "' (ID: ", group_id, ") deleted successfully.");
+            return true;
+        } else {
+            _say("Failed to delete group '", group_name, "' (ID: ", group_id, ").");
+            return false;
+        }
+    }
+
+    // Merges group 2 into group 1 in place: group 1 takes the linear merge of both groups'
+    // actual members (listed and pointing back at their group), the new name and goal, and
+    // their recounted total; group 2's members are moved over and group 2 is removed. Both records are journaled; the caller commits.
+    // Returns the former names of both groups (views into the name arena), or nullopt with
+    // error pointing at a description if the merge cannot be applied.
+    optional<pair<string_view, string_view>> _merge_groups(const string& group_id_1, const string& group_id_2,
+                                                           const string& new_group_name, int new_weekly_goal,
+                                                           const char*& error) {
+        Group* group1 = groups_tree.search(group_id_1);
+        Group* group2 = groups_tree.search(group_id_2);
+        if (group1 == nullptr || group2 == nullptr) { error = "group not found"; return nullopt; }
+        if (group1 == group2) { error = "cannot merge a group with itself"; return nullopt; }
+
+        // An individual belongs to at most one group, so the actual members are disjoint
+        Group::MemberList members1 = _members_of(*group1);
+        Group::MemberList members2 = _members_of(*group2);
+        array<int, 2 * Group::MAX_MEMBERS> merged;
+        size_t count = merge(members1.begin(), members1.end(), members2.begin(), members2.end(), merged.begin()) -
+                       merged.begin();
+        if (count > Group::MAX_MEMBERS) { error = "the merged group would exceed the member limit"; return nullopt; }
+        pair<string_view, string_view> former_names(group1->group_name, group2->group_name);
+
+        for (int member_id : members2) individuals_tree.search(member_id)->group = group1->handle;
+        _unrank_group(*group1);
+        _unrank_group(*group2);
+        group1->member_ids.clear();
+        for (size_t i = 0; i < count; ++i) group1->member_ids.push_back(merged[i]);
+        group1->group_name = names.store(new_group_name);
+        group1->weekly_group_goal = new_weekly_goal;
+        group1->total_weekly_steps = _sum_member_steps(*group1);
+        _rank_group(*group1);
+        _log_group(*group1);
+
+        GroupKey key2 = group2->key; // Views the interned ID, so it outlives the record
+        _log_group_deleted(group_id_2);
+        groups_tree.remove(key2); // Invalidates group1 and group2
+        return former_names;
+    }
+
+    // Folds the journal into a fresh snapshot and truncates it.
+    // The journal is kept if the snapshot could not be written. With background writes the
+    // state is captured here and written by the journal's writer thread; false then only
+    // means the capture failed.
+    bool _compact() {
+        if (journal.background_writes()) {
+            optional<SnapshotImage> image = _capture_snapshot();
+            if (!image) return false;
+            auto shared_image = make_shared<const SnapshotImage>(std::move(*image));
+            journal.compact_in_background([shared_image, path = snapshot_file] { return shared_image->write(path); });
+            return true;
+        }
+        journal.commit();
+        if (!_save_snapshot()) return false;
+        journal.reset();
+        _say("Data saved to snapshot file '", snapshot_file, "'.");
+        return true;
+    }
+
+    // Ends a mutation: writes the journal if the group-commit policy says so and
+    // compacts it into the snapshot once it has grown long enough.
+    void _commit() {
+        if (journal.compaction_due()) {
+            _compact();
+        } else if (journal.commit_due()) {
+            journal.commit();
+        }
+    }
+
+public:
+    // Constructor for StepTrackerApp, initializes file names and loads initial data: the
+    // snapshot if one exists, otherwise the CSV files (which then become the snapshot)
+    StepTrackerApp(string ind_file = "individuals.csv", string grp_file = "groups.csv",
+                   string journal_file = "step_tracker.journal", JournalPolicy journal_policy = JournalPolicy(),
+                   string snap_file = "step_tracker.snapshot")
+        : individuals_file(std::move(ind_file)), groups_file(std::move(grp_file)),
+          snapshot_file(std::move(snap_file)), journal(std::move(journal_file), journal_policy) {
+        _load_data(); // Load data when the application is initialized
+    }
+
+    // Chooses how the printing methods render reports: Text (the default console output),
+    // Csv, Json, or Quiet, which skips formatting and all status messages. The query
+    // methods (leader_board, group_range_info, ...) return the same data unformatted.
+    void set_output_format(OutputFormat format) {
+        output_format.store(format, memory_order_relaxed);
+    }
+
+    OutputFormat get_output_format() const { return output_format.load(memory_order_relaxed); }
+
+    // Sets how many threads (including the caller) run the parallel aggregations;
+    // 0 means one per hardware thread.
+    void set_thread_count(unsigned thread_count) {
+        WriteLock lock(state_mutex);
+        task_pool.set_thread_count(thread_count);
+    }
+
+    unsigned thread_count() const {
+        ReadLock lock(state_mutex);
+        return task_pool.thread_count();
+    }
+
+    // Changes the group-commit and compaction thresholds.
+    void set_journal_policy(const JournalPolicy& policy) {
+        WriteLock lock(state_mutex);
+        journal.set_policy(policy);
+    }
+
+    // Writes any buffered journal records now, regardless of the group-commit policy. With
+    // background writes they are handed to the writer thread and written shortly after.
+    void flush() {
+        WriteLock lock(state_mutex);
+        journal.commit();
+    }
+
+    // The original name of flush().
+    void flush_journal() { flush(); }
+
+    // Durability fence: returns once every mutation made before the call has reached the
+    // journal or snapshot files, including writes still queued in the background. Returns
+    // false if a background write failed since the last fence. Other callers keep running
+    // while it waits.
+    bool wait_durable() {
+        flush();
+        ReadLock lock(state_mutex); // Keeps the writer from being stopped under us
+        return journal.wait_written();
+    }
+
+    // Folds the journal into a fresh snapshot and truncates it.
+    // The journal is kept if the snapshot could not be written. Waits for the files even
+    // with background writes.
+    bool compact() {
+        WriteLock lock(state_mutex);
+        if (records_mapped.load(memory_order_relaxed)) return true; // Nothing changed since the snapshot was written
+        return _compact() && journal.wait_written();
+    }
+
+    // Writes the current state to the individuals and groups CSV files (the conversion
+    // path to and from text; startup reads the binary snapshot).
+    bool export_csv() const {
+        ReadLock lock(state_mutex);
+        _need_records();
+        return _export_csv();
+    }
+
+    // Replaces the current state with the contents of the CSV files, discarding the journal,
+    // and writes it as the new snapshot. Returns false if neither file exists.
+    bool import_csv() {
+        WriteLock lock(state_mutex);
+        if (!ifstream(individuals_file) && !ifstream(groups_file)) {
+            _say("Error: Neither CSV file '", individuals_file, "' nor '", groups_file, "' exists.");
+            return false;
+        }
+        _load_data(true);
+        return true;
+    }
+
+    // Public getters for the trees (for testing in main). These are not synchronized;
+    // concurrent callers should use with_read_lock() instead.
+    IndividualTree& get_individuals_tree() {
+        _need_records();
+        return individuals_tree;
+    }
+    GroupTree& get_groups_tree() {
+        _need_records();
+        return groups_tree;
+    }
+
+    // The Group ID an individual belongs to, or an empty view if none.
+    string_view group_id_of(const Individual& individual) const {
+        ReadLock lock(state_mutex);
+        return group_ids.id_of(individual.group);
+    }
+
+    // Debug description of an individual, including their steps and group.
+    string describe(const Individual& individual) const {
+        ReadLock lock(state_mutex);
+        int32_t weekly_steps[StepStore::DAYS];
+        size_t days = step_store.copy_days(individual.step_slot, weekly_steps);
+        return individual.toString(weekly_steps, days, group_ids.id_of(individual.group));
+    }
+
+    // Runs fn(individuals, groups) under the shared lock, so a multi-step report sees one
+    // consistent state. fn must not call back into the app.
+    template <typename Fn>
+    void with_read_lock(Fn&& fn) const {
+        ReadLock lock(state_mutex);
+        _need_records();
+        fn(static_cast<const IndividualTree&>(individuals_tree), static_cast<const GroupTree&>(groups_tree));
+    }
+
+
+    // Adds a new individual to the tree of individuals. The tree remains sorted.
+    bool add_person(int id, const string& name, int age, int daily_step_goal, const vector<int>& weekly_step_count) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::AddPerson);
+        WriteLock lock(state_mutex);
+        _need_records();
+        if (individuals_tree.search(id) != nullptr) { // Check if individual with this ID already exists
+            _say("Error: Individual with ID ", id, " already exists.");
+            return false;
+        }
+        Individual individual(id, names.store(name), age, daily_step_goal);
+        individual.step_slot = step_store.allocate(weekly_step_count, individual.daily_step_goal);
+        daily_top.add(individual);
+        _log_individual(individual);
+        individuals_tree.insert(std::move(individual)); // Insert new individual
+        _commit(); // Persist the change
+        _say("Individual ", name, " (ID: ", id, ") added successfully.");
+        return true;
+    }
+
+    // A copy of one individual's record, steps and Group ID, or nullopt if they do not exist.
+    optional<IndividualImage> export_individual(int individual_id) const {
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            const SnapshotIndividual* record = snapshot.find_individual(individual_id);
+            if (record == nullptr) return nullopt;
+            return _snapshot_image(*record);
+        }
+        const Individual* individual = individuals_tree.search(individual_id);
+        if (individual == nullptr) return nullopt;
+        IndividualImage image{individual->id, string(individual->name), individual->age, individual->daily_step_goal,
+                              individual->points, vector<int>(step_store.length(individual->step_slot)),
+                              step_store.history(individual->step_slot), string(group_ids.id_of(individual->group))};
+        step_store.copy_days(individual->step_slot, image.weekly_steps.data());
+        return image;
+    }
+
+    // Adds an individual taken by export_individual() from another app, keeping their points.
+    // They join no group here, whatever image.group_id says.
+    bool import_individual(const IndividualImage& image) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::AddPerson);
+        WriteLock lock(state_mutex);
+        _need_records();
+        if (individuals_tree.search(image.id) != nullptr) {
+            _say("Error: Individual with ID ", image.id, " already exists.");
+            return false;
+        }
+        Individual individual(image.id, names.store(image.name), image.age, image.daily_step_goal);
+        individual.points = image.points;
+        individual.step_slot = step_store.allocate(image.weekly_steps, individual.daily_step_goal);
+        step_store.set_history(individual.step_slot, image.history);
+        daily_top.add(individual);
+        _log_individual(individual);
+        _log_history(individual);
+        individuals_tree.insert(std::move(individual));
+        _commit();
+        return true;
+    }
+
+    // Creates a new group and adds existing individuals to it.
+    // An individual cannot be added to a new group if they already belong to one.
+    // A group can contain a maximum of 5 individuals.
+    bool create_group(const string& group_id, const string& group_name, const vector<int>& member_ids, int weekly_group_goal) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::CreateGroup);
+        WriteLock lock(state_mutex);
+        _need_records();
+        if (groups_tree.search(group_id) != nullptr) { // Check if group with this ID already exists
+            _say("Error: Group with ID ", group_id, " already exists.");
+            return false;
+        }
+        if (member_ids.size() > Group::MAX_MEMBERS) { // Check maximum members limit
+            _say("Error: A group cannot have more than ", Group::MAX_MEMBERS, " members.");
+            return false;
+        }
+
+        vector<int> actual_member_ids;
+        for (int mid : member_ids) { // Iterate through proposed member IDs
+            Individual* individual = individuals_tree.search(mid); // Find individual in the tree
+            if (individual == nullptr) {
+                _say("Warning: Individual with ID ", mid, " not found. Skipping.");
+                continue;
+            }
+            if (individual->group != NO_GROUP) { // Check if individual is already in a group
+                _say("Warning: Individual ", individual->name, " (ID: ", mid, ") already belongs to group ", group_ids.id_of(individual->group), ". Skipping.");
+                continue;
+            }
+            actual_member_ids.push_back(mid); // Add valid member to the list
+        }
+
+        if (actual_member_ids.empty()) { // If no valid members could be added
+            _say("Error: No valid members to create the group.");
+            return false;
+        }
+
+        Group new_group(group_id, group_name, actual_member_ids, weekly_group_goal);
+        _intern_group(new_group);
+        GroupHandle handle = new_group.handle;
+        groups_tree.insert(std::move(new_group)); // Insert new group
+
+        // Update individuals' group to reflect their new group membership
+        for (int mid : actual_member_ids) {
+            Individual* individual = individuals_tree.search(mid);
+            if (individual) {
+                individual->group = handle;
+            }
+        }
+        Group* group = groups_tree.search(group_id);
+        group->total_weekly_steps = _sum_member_steps(*group);
+        _rank_group(*group);
+        _log_group(*group);
+        _commit(); // Persist the change
+        string member_list;
+        for (int mid : actual_member_ids) member_list += to_string(mid) + " ";
+        _say("Group '", group_name, "' (ID: ", group_id, ") created successfully with members: ", member_list, ".");
+        return true;
+    }
+
+    // Records an individual's step total for a day as reported by their device; a later
+    // report for the same day replaces it. `day` is a number on the app's day counter:
+    // current_day() is today, the six days before it overwrite history, and a later day
+    // first advances the week to it (see advance_to_day). The weekly sum, the group total and
+    // today's ranking are updated incrementally. Returns false for unknown individuals,
+    // negative counts, and days before the recorded week.
+    bool record_steps(int individual_id, int day, int steps) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::RecordSteps);
+        WriteLock lock(state_mutex);
+        _need_records();
+        const char* error = nullptr;
+        if (!_record_steps(StepRecord{individual_id, day, steps}, error)) {
+            _say("Error: Could not record steps for individual ", individual_id, " on day ", day, " (", error, ").");
+            return false;
+        }
+        _commit();
+        return true;
+    }
+
+    // Applies many device reports in order under one lock with a single journal commit.
+    // Reports that cannot be applied are skipped. Returns how many were recorded.
+    size_t record_steps_batch(const StepRecord* records, size_t count) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::RecordSteps);
+        WriteLock lock(state_mutex);
+        _need_records();
+        size_t recorded = 0;
+        const char* error = nullptr;
+        for (size_t i = 0; i < count; ++i) recorded += _record_steps(records[i], error);
+        if (recorded > 0) _commit();
+        _say("Recorded ", recorded, " of ", count, " step reports.");
+        return recorded;
+    }
+
+    size_t record_steps_batch(const vector<StepRecord>& records) {
+        return record_steps_batch(records.data(), records.size());
+    }
+
+    // Starts a new day (or several, if `day` is further ahead): every individual's week rolls
+    // forward in O(1) with zero steps for the new days, group totals drop the evicted days,
+    // and today's ranking starts over. Days at or before current_day() are ignored.
+    void advance_to_day(int day) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::AdvanceDay);
+        WriteLock lock(state_mutex);
+        _need_records();
+        if (day <= day_number) return;
+        _advance_to_day(day);
+        _commit();
+    }
+
+    // The day number of today, the newest entry of every step history. Starts at 0 for
+    // data imported from CSV and is kept in the snapshot.
+    int current_day() const {
+        ReadLock lock(state_mutex);
+        return day_number;
+    }
+
+    // Displays the top 3 individuals who have completed their daily step goals and achieved the highest steps for the current day.
+    // Individuals who have not completed daily goals are excluded.
+    // Assumes the last day of the step history is today's steps.
+    vector<Individual*> get_top_3() {
+        STEP_TRACKER_STAT_SCOPE(StatOp::TopIndividuals);
+        ReadLock lock(state_mutex);
+        _need_records();
+        vector<Individual*> top_3_result = _top_individuals(3);
+        _render([&](ReportRenderer& out) { out.top_individuals(3, _daily_leaders(top_3_result)); });
+        return top_3_result;
+    }
+
+    // Today's k best goal achievers as report entries (rank, ID, name, today's steps).
+    vector<DailyRankEntry> daily_leaders(size_t k) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::TopIndividuals);
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            if (optional<vector<const SnapshotIndividual*>> top = _snapshot_daily_top(k)) {
+                vector<DailyRankEntry> entries;
+                for (const SnapshotIndividual* record : *top) {
+                    entries.push_back({entries.size() + 1, record->id, string(snapshot.name_of(*record)),
+                                       snapshot.today_of(*record)});
+                }
+                return entries;
+            }
+            _need_records();
+        }
+        return _daily_leaders(_top_individuals(k));
+    }
+
+    // Returns the k individuals with the most steps today among those who met their daily
+    // goal (ties by ID), without sorting the population. Pointers are invalidated by the next mutation.
+    vector<Individual*> top_individuals(size_t k) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::TopIndividuals);
+        ReadLock lock(state_mutex);
+        _need_records();
+        return _top_individuals(k);
+    }
+
+    // 1-based rank of an individual among the top K daily goal achievers, or 0 if they are outside it.
+    size_t individual_daily_rank(int individual_id) const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::RankQuery);
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            if (optional<size_t> rank = _snapshot_daily_rank(individual_id)) return *rank;
+            _need_records();
+        }
+        return daily_top.rank_in_top(individual_id);
+    }
+
+    // Sets how many daily goal achievers the top-K tracker keeps ready for rank lookups.
+    // It never drops below the number of rewarded ranks.
+    void set_top_k(size_t k) {
+        WriteLock lock(state_mutex);
+        daily_top.set_capacity(max(k, reward_points.size()));
+    }
+
+    // Sets the points awarded to daily ranks 1..K (e.g. {100, 75, 50}).
+    void set_reward_points(vector<int> points_by_rank) {
+        WriteLock lock(state_mutex);
+        reward_points = std::move(points_by_rank);
+        if (daily_top.capacity() < reward_points.size()) daily_top.set_capacity(reward_points.size());
+    }
+
+    // Awards today's points to every rewarded rank at once: rankings are read once, each
+    // winner is updated and journaled, and a single commit follows. This is the only path
+    // that awards points (check_individual_rewards only reports them). Each day is settled at
+    // most once: the settled day is journaled and kept in the snapshot, so a repeat call
+    // for the same day (a retried daily job, also after a restart) awards nothing and
+    // returns an empty result. Returns the (individual ID, points awarded) pairs in rank order.
+    vector<pair<int, int>> settle_daily_rewards() {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Rewards);
+        WriteLock lock(state_mutex);
+        _need_records();
+        vector<pair<int, int>> awarded;
+        if (day_number < next_settle_day) {
+            _say("Daily rewards for day ", day_number, " were already settled.");
+            return awarded;
+        }
+        for (const DailyTopK::Key& key : daily_top.first(reward_points.size())) {
+            Individual* individual = individuals_tree.search(key.second);
+            if (individual == nullptr) continue;
+            int points_earned = reward_points[awarded.size()];
+            individual->points += points_earned;
+            _log_individual(*individual);
+            awarded.emplace_back(individual->id, points_earned);
+        }
+        next_settle_day = day_number + 1;
+        journal.append("R," + to_string(day_number));
+        _commit(); // Persist updated points and the settled day
+        _say("Settled daily rewards for ", awarded.size(), " individuals.");
+        return awarded;
+    }
+
+    // Whether the given group has completed its weekly group goal, or nullopt if it does not exist.
+    optional<GroupAchievement> group_achievement(const string& group_id) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::GroupAchievement);
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            const SnapshotGroup* record = snapshot.find_group(group_id);
+            if (record == nullptr) return nullopt;
+            return GroupAchievement{string(snapshot.id_of(*record)), string(snapshot.name_of(*record)),
+                                    record->weekly_group_goal, snapshot.total_of(*record)};
+        }
+        const Group* group = groups_tree.search(group_id);
+        if (group == nullptr) return nullopt;
+        // The total is maintained incrementally by the mutators
+        return GroupAchievement{group->group_id, string(group->group_name), group->weekly_group_goal, group->total_weekly_steps};
+    }
+
+    // IDs of the individuals whose membership is this group, in member-list order, or nullopt
+    // if the group does not exist. Unlike the report members, it leaves out listed IDs that
+    // do not exist or belong to another group (a CSV can list an ID in two groups).
+    optional<vector<int>> group_members(const string& group_id) const {
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            const SnapshotGroup* record = snapshot.find_group(group_id);
+            if (record == nullptr) return nullopt;
+            vector<int> member_ids;
+            for (size_t i = 0; i < snapshot.member_count_of(*record); ++i) {
+                const SnapshotIndividual* member = snapshot.find_individual(record->member_ids[i]);
+                if (member && snapshot.group_of(*member) == record) member_ids.push_back(member->id);
+            }
+            return member_ids;
+        }
+        const Group* group = groups_tree.search(group_id);
+        if (group == nullptr) return nullopt;
+        Group::MemberList members = _members_of(*group);
+        return vector<int>(members.begin(), members.end());
+    }
+
+    // Displays whether the given group has completed its weekly group goal.
+    bool check_group_achievement(const string& group_id) {
+        optional<GroupAchievement> result = group_achievement(group_id);
+        if (!result) {
+            _say("Error: Group with ID ", group_id, " not found.");
+            return false;
+        }
+        _render([&](ReportRenderer& out) { out.group_achievement(*result); });
+        return result->achieved();
+    }
+
+    // Returns the k highest-ranked groups (highest total weekly steps first, ties by Group ID)
+    // in O(log G + k). Pointers are invalidated by the next mutation.
+    vector<Group*> top_groups(size_t k) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::LeaderBoard);
+        ReadLock lock(state_mutex);
+        _need_records();
+        return _top_groups(k);
+    }
+
+    // Returns the 1-based leaderboard rank of a group in O(log G), or 0 if it does not exist.
+    size_t group_rank(const string& group_id) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::RankQuery);
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            const SnapshotGroup* record = snapshot.find_group(group_id);
+            if (record == nullptr) return 0;
+            return snapshot.groups_ranked_ahead(snapshot.total_of(*record), GroupKey(snapshot.id_of(*record))) + 1;
+        }
+        const Group* group = groups_tree.search(group_id);
+        if (group == nullptr) return 0;
+        size_t rank = group_rankings.rank(GroupRankKey(group->total_weekly_steps, group->key));
+        return rank == GroupRankings::npos ? 0 : rank + 1;
+    }
+
+    // Number of this app's groups that rank ahead of a group with the given total and ID,
+    // whether or not that group is here. Summed over the shards of a ShardedStepTracker,
+    // plus one, it is the group's global rank.
+    size_t groups_ranked_ahead(long long total_weekly_steps, const string& group_id) const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::RankQuery);
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) return snapshot.groups_ranked_ahead(total_weekly_steps, GroupKey(group_id));
+        return group_rankings.count_before(GroupRankKey(total_weekly_steps, GroupKey(group_id)));
+    }
+
+    // The k highest-ranked groups as leaderboard entries (all groups by default). Repeated
+    // calls are served from the query cache until a group changes.
+    LeaderboardResult leader_board(size_t k = SIZE_MAX) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::LeaderBoard);
+        ReadLock lock(state_mutex);
+        string key = "leader_board:" + to_string(k);
+        if (LeaderboardResult cached = query_cache.find<LeaderboardResult>(key, version.groups)) return cached;
+        auto entries = make_shared<vector<LeaderboardEntry>>();
+        if (records_mapped.load(memory_order_acquire)) {
+            size_t count = min(k, snapshot.group_count());
+            entries->reserve(count);
+            for (size_t position = 0; position < count; ++position) {
+                const SnapshotGroup* group = snapshot.ranked_group(position);
+                if (group == nullptr) break;
+                entries->push_back({entries->size() + 1, string(snapshot.id_of(*group)), string(snapshot.name_of(*group)),
+                                    snapshot.total_of(*group)});
+            }
+        } else {
+            entries->reserve(min(k, group_rankings.size()));
+            for (const Group* group : _top_groups(k)) {
+                entries->push_back({entries->size() + 1, group->group_id, string(group->group_name), group->total_weekly_steps});
+            }
+        }
+        LeaderboardResult result = std::move(entries);
+        query_cache.insert(std::move(key), version.groups, result);
+        return result;
+    }
+
+    // Generates and displays a leaderboard for groups, sorted by total weekly steps (Descending).
+    LeaderboardResult generate_leader_board() {
+        LeaderboardResult entries = leader_board();
+        _render([&](ReportRenderer& out) { out.leader_board(*entries); });
+        return entries;
+    }
+
+    // Displays the given individual's daily rank and the points it earns if they are in the top 3
+    // daily goal achievers. Report-only: settle_daily_rewards is the one path that awards points,
+    // so checking a winner and then settling the day pays them once.
+    void check_individual_rewards(int individual_id) const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Rewards);
+        ReadLock lock(state_mutex);
+        _report_individual_reward(individual_id);
+    }
+
+    // Checks many individuals against one ranking under one lock.
+    void check_individual_rewards(const vector<int>& individual_ids) const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Rewards);
+        ReadLock lock(state_mutex);
+        for (int individual_id : individual_ids) _report_individual_reward(individual_id);
+    }
+
+    // Deletes an individual from the individuals tree and removes them from any group they belong to.
+    bool delete_individual(int individual_id) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::DeleteIndividual);
+        WriteLock lock(state_mutex);
+        _need_records();
+        Individual* individual = individuals_tree.search(individual_id); // Find the individual
+        if (individual == nullptr) {
+            _say("Error: Individual with ID ", individual_id, " not found.");
+            return false;
+        }
+
+        // If the individual belongs to a group, remove them from that group's member list
+        if (individual->group != NO_GROUP) {
+            Group* group = _group_of(*individual);
+            if (group) {
+                // Use std::remove to move the element to the end, then erase it
+                auto it = remove(group->member_ids.begin(), group->member_ids.end(), individual_id);
+                if (it != group->member_ids.end()) {
+                    group->member_ids.erase(it, group->member_ids.end());
+                    _adjust_group_total(*group, -step_store.row_sum(individual->step_slot));
+                    _log_group(*group);
+                    _say("Individual ", individual->name, " removed from group ", group->group_name, ".");
+                }
+            }
+        }
+
+        // Delete individual from the individuals tree (copy the name first: removal invalidates the pointer)
+        string name(individual->name);
+        daily_top.remove(*individual);
+        step_store.release(individual->step_slot);
+        if (individuals_tree.remove(individual_id)) {
+            _log_individual_deleted(individual_id);
+            _commit(); // Persist the change
+            _say("Individual ", name, " (ID: ", individual_id, ") deleted successfully.");
+            return true;
+        } else {
+            _say("Failed to delete individual ", name, " (ID: ", individual_id, ").");
+            return false;
+        }
+    }
+
+    // Deletes a batch of individuals (e.g. churned accounts) and removes them from their groups.
+    // The tree is compacted in one pass and the data is saved once. Returns the number deleted.
+    size_t delete_individuals(const vector<int>& individual_ids) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::DeleteIndividuals);
+        WriteLock lock(state_mutex);
+        _need_records();
+        ScratchArena scratch(&scratch_memory);
+        pmr::set<GroupHandle> touched_groups(scratch.resource());
+        for (int individual_id : individual_ids) {
+            Individual* individual = individuals_tree.search(individual_id);
+            if (individual == nullptr) continue;
+            if (individual->step_slot == StepStore::NO_SLOT) continue; // Duplicate ID in the batch
+            daily_top.remove(*individual);
+            _log_individual_deleted(individual_id);
+            if (individual->group != NO_GROUP) {
+                Group* group = _group_of(*individual);
+                if (group) {
+                    auto it = remove(group->member_ids.begin(), group->member_ids.end(), individual_id);
+                    if (it != group->member_ids.end()) {
+                        group->member_ids.erase(it, group->member_ids.end());
+                        _adjust_group_total(*group, -step_store.row_sum(individual->step_slot));
+                    }
+                    touched_groups.insert(group->handle);
+                }
+            }
+            step_store.release(individual->step_slot);
+            individual->step_slot = StepStore::NO_SLOT;
+        }
+        for (GroupHandle handle : touched_groups) {
+            _log_group(*groups_tree.search(group_ids.key_of(handle)));
+        }
+
+        size_t removed = individuals_tree.remove_many(individual_ids);
+        if (removed > 0) {
+            _commit(); // Persist the changes
+        }
+        _say(removed, " of ", individual_ids.size(), " individuals deleted successfully.");
+        return removed;
+    }
+
+    // Deletes a group from the groups tree but retains its individuals, making them available for other groups.
+    bool delete_group(const string& group_id) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::DeleteGroup);
+        WriteLock lock(state_mutex);
+        _need_records();
+        return _delete_group(group_id);
+    }
+
+    // Merges the second group into the first, which keeps its ID and takes the new name
+    // and goal. The first group's record is rewritten in place, the second is removed once,
+    // and the journal is committed once. Returns false if either group is missing, they are
+    // the same group, or the merged group would exceed MAX_MEMBERS.
+    bool merge_groups(const string& group_id_1, const string& group_id_2, const string& new_group_name, int new_weekly_goal) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::MergeGroups);
+        WriteLock lock(state_mutex);
+        _need_records();
+        const char* error = nullptr;
+        optional<pair<string_view, string_view>> former_names =
+            _merge_groups(group_id_1, group_id_2, new_group_name, new_weekly_goal, error);
+        if (!former_names) {
+            _say("Error: Could not merge group ", group_id_2, " into ", group_id_1, " (", error, ").");
+            return false;
+        }
+        _commit(); // Persist the change
+        _say("Groups '", former_names->first, "' and '", former_names->second,
+             "' merged into new group '", new_group_name, "' (ID: ", group_id_1, ").");
+        return true;
+    }
+
+    // Applies many merges in order under one lock with a single journal commit, for
+    // consolidation runs. A merge that cannot be applied is skipped; a group merged away
+    // earlier in the batch no longer exists for the later ones. Returns how many were merged.
+    size_t merge_groups_many(const vector<GroupMerge>& merges) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::MergeGroups);
+        WriteLock lock(state_mutex);
+        _need_records();
+        size_t merged = 0;
+        const char* error = nullptr;
+        for (const GroupMerge& merge : merges) {
+            merged += _merge_groups(merge.group_id_1, merge.group_id_2, merge.new_group_name, merge.new_weekly_goal,
+                                    error).has_value();
+        }
+        if (merged > 0) _commit();
+        _say("Merged ", merged, " of ", merges.size(), " group pairs.");
+        return merged;
+    }
+
+    // Groups with IDs in [start_group_id, end_group_id] ranked by total weekly steps within
+    // the range (ties in Group ID order), with their members' names. Repeated calls are
+    // served from the query cache until a group or an individual changes: a group can list
+    // an ID with no individual, who may be added later without touching the group.
+    GroupRangeResult group_range_info(const string& start_group_id, const string& end_group_id) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::GroupRange);
+        ReadLock lock(state_mutex);
+        string key = "group_range:" + to_string(start_group_id.size()) + ":" + start_group_id + end_group_id;
+        if (GroupRangeResult cached = query_cache.find<GroupRangeResult>(key, version.combined())) return cached;
+        if (records_mapped.load(memory_order_acquire)) {
+            GroupRangeResult result = _snapshot_group_range(start_group_id, end_group_id);
+            query_cache.insert(std::move(key), version.combined(), result);
+            return result;
+        }
+        // Walk only the groups inside the range, in Group ID order, without copying them
+        ScratchArena scratch(&scratch_memory);
+        pmr::vector<const Group*> groups(scratch.resource());
+        for (const Group& group : groups_tree.range(start_group_id, end_group_id)) groups.push_back(&group);
+        stable_sort(groups.begin(), groups.end(), [](const Group* a, const Group* b) {
+            return a->total_weekly_steps > b->total_weekly_steps;
+        });
+
+        auto entries = make_shared<vector<GroupRangeEntry>>();
+        entries->reserve(groups.size());
+        for (const Group* group : groups) {
+            GroupRangeEntry entry{entries->size() + 1, group->group_id, string(group->group_name),
+                                  group->weekly_group_goal, group->total_weekly_steps, {}};
+            for (int member_id : group->member_ids) {
+                const Individual* individual = individuals_tree.search(member_id);
+                if (individual) entry.members.emplace_back(individual->id, individual->name);
+            }
+            entries->push_back(std::move(entry));
+        }
+        GroupRangeResult result = std::move(entries);
+        query_cache.insert(std::move(key), version.combined(), result);
+        return result;
+    }
+
+    // Displays information about members in the range of given group IDs, including group goals and ranks.
+    GroupRangeResult display_group_range_info(const string& start_group_id, const string& end_group_id) {
+        GroupRangeResult entries = group_range_info(start_group_id, end_group_id);
+        _render([&](ReportRenderer& out) { out.group_range(start_group_id, end_group_id, *entries); });
+        return entries;
+    }
+
+    // Weekly analysis of every individual, returned in ID order: total steps, days at or
+    // above the daily goal, and days recorded. The step store is swept in linear SIMD
+    // chunks across the task pool.
+    vector<pair<int, StepRowStats>> analyze_all_individuals() const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Analysis);
+        ReadLock lock(state_mutex);
+        _need_records();
+        ScratchArena scratch(&scratch_memory);
+        pmr::vector<StepRowStats> by_slot(step_store.slot_count(), scratch.resource());
+        task_pool.parallel_for(by_slot.size(), TaskPool::DEFAULT_GRAIN, [&](size_t begin, size_t end) {
+            step_store.analyze_range(begin, end, by_slot.data() + begin);
+        });
+        vector<pair<int, StepRowStats>> result;
+        result.reserve(individuals_tree.size());
+        for (const Individual& individual : individuals_tree) {
+            StepRowStats stats;
+            if (individual.step_slot < by_slot.size()) stats = by_slot[individual.step_slot];
+            result.emplace_back(individual.id, stats);
+        }
+        return result;
+    }
+
+    // Population-wide totals over all individuals and groups, reduced chunk by chunk across
+    // the task pool in a fixed order.
+    PopulationSummary population_summary() const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Analysis);
+        ReadLock lock(state_mutex);
+        _need_records();
+        PopulationSummary summary = task_pool.parallel_reduce(
+            step_store.slot_count(), TaskPool::DEFAULT_GRAIN, PopulationSummary(),
+            [&](size_t begin, size_t end) {
+                StepRowStats rows[TaskPool::DEFAULT_GRAIN];
+                step_store.analyze_range(begin, end, rows);
+                PopulationSummary part;
+                for (size_t i = 0; i < end - begin; ++i) { // Free rows are all zero
+                    part.individual_steps += rows[i].total_steps;
+                    part.goal_days += rows[i].days_met_goal;
+                }
+                return part;
+            },
+            [](PopulationSummary acc, const PopulationSummary& part) {
+                acc.individual_steps += part.individual_steps;
+                acc.goal_days += part.goal_days;
+                return acc;
+            });
+        summary.individuals = individuals_tree.size();
+        summary.daily_achievers = daily_top.qualifier_count();
+
+        ScratchArena scratch(&scratch_memory);
+        pmr::vector<const Group*> groups(scratch.resource());
+        groups.reserve(groups_tree.size());
+        for (const Group& group : groups_tree) groups.push_back(&group);
+        summary.groups = groups.size();
+        pair<long long, size_t> group_totals = task_pool.parallel_reduce(
+            groups.size(), TaskPool::DEFAULT_GRAIN, pair<long long, size_t>(0, 0),
+            [&](size_t begin, size_t end) {
+                pair<long long, size_t> part(0, 0);
+                for (size_t i = begin; i < end; ++i) {
+                    part.first += groups[i]->total_weekly_steps;
+                    part.second += groups[i]->total_weekly_steps >= groups[i]->weekly_group_goal;
+                }
+                return part;
+            },
+            [](pair<long long, size_t> acc, const pair<long long, size_t>& part) {
+                return make_pair(acc.first + part.first, acc.second + part.second);
+            });
+        summary.group_steps = group_totals.first;
+        summary.groups_at_goal = group_totals.second;
+        return summary;
+    }
+
+    // The data's mutation counters. Callers holding results can compare versions to tell
+    // whether the data changed since.
+    DataVersion data_version() const {
+        ReadLock lock(state_mutex);
+        return version;
+    }
+
+    // Bounds the query cache to this many result rows (leaderboard or range entries); 0
+    // turns it off. The default is QueryCache::DEFAULT_CAPACITY_ROWS.
+    void set_query_cache_capacity(size_t rows) {
+        query_cache.set_capacity(rows); // The cache has its own lock
+    }
+
+    QueryCacheStats query_cache_stats() const {
+        return query_cache.stats();
+    }
+
+    // Heap allocations made on behalf of the tree node pools and the query scratch arenas.
+    MemoryStats allocation_stats() const {
+        return MemoryStats{tree_memory.stats(), scratch_memory.stats()}; // Counters are atomic; no lock needed
+    }
+
+    // Per-operation instrumentation counters, summed over all threads of the process.
+    // Empty, with enabled == false, unless built with -DSTEP_TRACKER_STATS.
+    StatsSnapshot stats() const {
+        return collect_stats(); // Counters are per thread and atomic; no lock needed
+    }
+
+    // Writes stats() as a JSON line to `out` every `interval` from a background thread;
+    // a zero interval stops it. `out` must stay valid until the dumping stops.
+    void dump_stats_every(chrono::milliseconds interval, ostream& out = cerr) {
+        WriteLock lock(state_mutex);
+        stats_dumper.reset();
+        if (interval.count() > 0) stats_dumper = make_unique<StatsDumper>(interval, out);
+    }
+
+    // Step stats of one individual over days [first_day, last_day] on the day counter,
+    // read from their archived history and the current week; days with no entry are not
+    // counted. Whole archived blocks are read from their summaries. nullopt if the
+    // individual does not exist.
+    optional<StepWindowStats> step_history(int individual_id, int first_day, int last_day) const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Analysis);
+        ReadLock lock(state_mutex);
+        _need_records();
+        const Individual* individual = individuals_tree.search(individual_id);
+        if (individual == nullptr) return nullopt;
+        return step_store.window(individual->step_slot, day_number, first_day, last_day);
+    }
+
+    // step_history() combined over a group's current members, or nullopt if the group does
+    // not exist. days counts member-days, and min and max are over single member-days.
+    optional<StepWindowStats> group_step_history(const string& group_id, int first_day, int last_day) const {
+        STEP_TRACKER_STAT_SCOPE(StatOp::Analysis);
+        ReadLock lock(state_mutex);
+        _need_records();
+        const Group* group = groups_tree.search(group_id);
+        if (group == nullptr) return nullopt;
+        StepWindowStats stats;
+        for (int member_id : group->member_ids) {
+            const Individual* individual = individuals_tree.search(member_id);
+            if (individual) stats.merge(step_store.window(individual->step_slot, day_number, first_day, last_day));
+        }
+        return stats;
+    }
+
+    // The goal suggestion for one individual, or nullopt if they do not exist. By default
+    // it is based on the week; window_days bases it on that many days up to today instead,
+    // reaching into the archived history.
+    optional<GoalSuggestion> goal_suggestion(int individual_id, int window_days = StepStore::DAYS) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::GoalSuggestion);
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            if (window_days == static_cast<int>(StepStore::DAYS)) {
+                const SnapshotIndividual* record = snapshot.find_individual(individual_id);
+                if (record == nullptr) return nullopt;
+                return decide_goal_update(individual_id, record->daily_step_goal, _snapshot_week_stats(*record));
+            }
+            _need_records(); // Longer windows read the archived history through the step store
+        }
+        const Individual* individual = individuals_tree.search(individual_id);
+        if (individual == nullptr) return nullopt;
+        return decide_goal_update(individual_id, individual->daily_step_goal, _recent_stats(*individual, window_days));
+    }
+
+    // Suggests a daily goal update for an individual based on their recent performance
+    // (the week, or the last window_days days). The suggestion aims to help them
+    // consistently appear in the top 3.
+    // To apply suggestions automatically, use suggest_goal_updates_for_all(results, true).
+    optional<GoalSuggestion> suggest_goal_update(int individual_id, int window_days = StepStore::DAYS) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::GoalSuggestion);
+        ReadLock lock(state_mutex);
+        if (records_mapped.load(memory_order_acquire)) {
+            if (window_days == static_cast<int>(StepStore::DAYS)) {
+                const SnapshotIndividual* record = snapshot.find_individual(individual_id);
+                if (record == nullptr) {
+                    _say("Error: Individual with ID ", individual_id, " not found.");
+                    return nullopt;
+                }
+                GoalSuggestion suggestion = decide_goal_update(individual_id, record->daily_step_goal,
+                                                               _snapshot_week_stats(*record));
+                _render([&](ReportRenderer& out) { out.goal_suggestion(string(snapshot.name_of(*record)), suggestion); });
+                return suggestion;
+            }
+            _need_records();
+        }
+        const Individual* individual = individuals_tree.search(individual_id); // Find the individual
+        if (individual == nullptr) {
+            _say("Error: Individual with ID ", individual_id, " not found.");
+            return nullopt;
+        }
+        GoalSuggestion suggestion = decide_goal_update(individual_id, individual->daily_step_goal,
+                                                       _recent_stats(*individual, window_days));
+        _render([&](ReportRenderer& out) { out.goal_suggestion(string(individual->name), suggestion); });
+        return suggestion;
+    }
+
+    // Computes a goal suggestion for every individual, in ID order, into `out` (resized to
+    // the population; its capacity is reused across calls). The per-person analysis runs
+    // on the task pool. With `apply`, every changed goal is written back, logged, and
+    // committed once. Returns how many of the suggestions change a goal.
+    size_t suggest_goal_updates_for_all(vector<GoalSuggestion>& out, bool apply = false) {
+        STEP_TRACKER_STAT_SCOPE(StatOp::GoalSuggestionsForAll);
+        // Computing only needs a shared view; applying the goals is a mutation
+        WriteLock write_lock(state_mutex, defer_lock);
+        ReadLock read_lock(state_mutex, defer_lock);
+        if (apply) write_lock.lock(); else read_lock.lock();
+        _need_records();
+
+        ScratchArena scratch(&scratch_memory);
+        pmr::vector<Individual*> people(scratch.resource());
+        people.reserve(individuals_tree.size());
+        for (Individual& individual : individuals_tree) people.push_back(&individual);
+        out.resize(people.size());
+
+        task_pool.parallel_for(people.size(), TaskPool::DEFAULT_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const Individual& individual = *people[i];
+                out[i] = decide_goal_update(individual.id, individual.daily_step_goal,
+                                            step_store.analyze_slot(individual.step_slot));
+            }
+        });
+
+        size_t changed = 0;
+        for (size_t i = 0; i < people.size(); ++i) {
+            if (!out[i].changes_goal()) continue;
+            ++changed;
+            if (!apply) continue;
+            Individual& individual = *people[i];
+            daily_top.remove(individual); // Qualification for the top-K depends on the goal
+            individual.daily_step_goal = out[i].suggested_goal;
+            step_store.set_goal(individual.step_slot, individual.daily_step_goal);
+            daily_top.add(individual);
+            _log_individual(individual);
+        }
+        if (apply && changed > 0) _commit();
+        return changed;
+    }
+};
+
+// --- Sharded Application ---
+// Splits the groups across several StepTrackerApps by Group ID range, with every group's
+// members living on the group's shard; un-grouped individuals are spread by ID. Each shard
+// has its own lock, task pool, journal and snapshot, so work on different shards runs in
+// parallel. An operation on one group or individual is routed to its shard; the global
+// leaderboards, range reports and totals are gathered from the shards and merged. Each
+// shard is used only through its public API, which is the boundary a remote transport
+// would wrap to put shards on other nodes.
+
+// How the groups are split across shards, and where each shard keeps its files.
+struct ShardLayout {
+    vector<string> split_points; // Group IDs, ascending; shard i holds [split_points[i-1], split_points[i])
+    string file_prefix = "shard"; // Shard i uses <prefix><i>.individuals.csv, .groups.csv, .journal and .snapshot
+
+    size_t shard_count() const { return split_points.size() + 1; }
+    string file(size_t shard, const char* kind) const { return file_prefix + to_string(shard) + "." + kind; }
+};
+
+class ShardedStepTracker {
+private:
+    using ReadLock = shared_lock<shared_mutex>;
+    using WriteLock = unique_lock<shared_mutex>;
+
+    ShardLayout layout;
+    vector<GroupKey> split_keys; // Parsed layout.split_points (viewing them)
+    vector<unique_ptr<StepTrackerApp>> shards;
+    mutable TaskPool scatter_pool; // One thread per shard for the fan-out calls
+
+    // Exclusive while individuals are added, deleted or moved between shards, or the day
+    // changes; shared by everything else, which only needs the shards' own locks.
+    mutable shared_mutex directory_mutex;
+    unordered_map<int, uint32_t> home; // Individual ID -> shard
+    int day_number = 0;                 // current_day() of every shard
+    atomic<OutputFormat> output_format{OutputFormat::Text};
+
+    template <typename... Parts>
+    void _say(const Parts&... parts) const {
+        if (output_format.load(memory_order_relaxed) != OutputFormat::Text) return;
+        (cout << ... << parts) << '\n';
+    }
+
+    static vector<GroupKey> _split_keys(const ShardLayout& layout) {
+        return vector<GroupKey>(layout.split_points.begin(), layout.split_points.end());
+    }
+
+    static size_t _shard_of_group(const vector<GroupKey>& split_keys, string_view group_id) {
+        return upper_bound(split_keys.begin(), split_keys.end(), GroupKey(group_id)) - split_keys.begin();
+    }
+
+    size_t _shard_of_group(const string& group_id) const { return _shard_of_group(split_keys, group_id); }
+
+    // Where an individual lives, or where a new one goes: un-grouped individuals are
+    // spread by ID. Unknown IDs are routed there too, so that shard reports the error.
+    size_t _shard_of_individual(int individual_id) const {
+        auto it = home.find(individual_id);
+        return it != home.end() ? it->second : static_cast<uint32_t>(individual_id) % shards.size();
+    }
+
+    // Calls fn(shard_index, shard) for every shard in parallel.
+    template <typename Fn>
+    void _for_each_shard(const Fn& fn) const {
+        scatter_pool.parallel_for(shards.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) fn(i, *shards[i]);
+        });
+    }
+
+    // Indexes where each individual lives. A move cut short by a crash can leave a copy on
+    // two shards; the grouped copy is kept (the move had not finished), otherwise either.
+    void _build_directory() {
+        vector<pair<int, uint32_t>> duplicates;
+        for (uint32_t i = 0; i < shards.size(); ++i) {
+            shards[i]->with_read_lock([&](const IndividualTree& individuals, const GroupTree&) {
+                for (const Individual& individual : individuals) {
+                    if (!home.emplace(individual.id, i).second) duplicates.emplace_back(individual.id, i);
+                }
+            });
+        }
+        for (const auto& [individual_id, shard] : duplicates) {
+            uint32_t first = home[individual_id];
+            optional<IndividualImage> kept = shards[first]->export_individual(individual_id);
+            bool keep_first = kept && !kept->group_id.empty();
+            shards[keep_first ? shard : first]->delete_individual(individual_id);
+            home[individual_id] = keep_first ? first : shard;
+        }
+    }
+
+    // Moves all shards forward to the given day. (directory_mutex held exclusively)
+    void _advance_to_day(int day) {
+        if (day <= day_number) return;
+        _for_each_shard([&](size_t, StepTrackerApp& shard) { shard.advance_to_day(day); });
+        day_number = day;
+    }
+
+    // Moves an un-grouped individual to another shard. The copy is added before the original
+    // is deleted, so a crash in between leaves a duplicate rather than a loss. (directory_mutex
+    // held exclusively)
+    bool _move_individual(int individual_id, size_t to) {
+        auto it = home.find(individual_id);
+        if (it == home.end() || it->second == to) return it != home.end();
+        StepTrackerApp& from = *shards[it->second];
+        optional<IndividualImage> image = from.export_individual(individual_id);
+        if (!image || !image->group_id.empty() || !shards[to]->import_individual(*image)) return false;
+        from.delete_individual(individual_id);
+        it->second = static_cast<uint32_t>(to);
+        return true;
+    }
+
+    // Merges two groups that live on different shards: group 2 and its members are copied to
+    // group 1's shard and merged there, and only then deleted from group 2's shard. If any
+    // step on group 1's shard fails, the copies made so far are deleted again and group 2
+    // stays where it was. Not atomic across the two shards: a crash part-way can leave the
+    // members on both shards (group 1's copies un-grouped), but never loses them.
+    // (directory_mutex held exclusively)
+    bool _merge_across_shards(size_t target_shard, size_t source_shard, const GroupMerge& merge) {
+        StepTrackerApp& target = *shards[target_shard];
+        StepTrackerApp& source = *shards[source_shard];
+        optional<GroupAchievement> second = source.group_achievement(merge.group_id_2);
+        optional<vector<int>> first_members = target.group_members(merge.group_id_1);
+        optional<vector<int>> member_ids = source.group_members(merge.group_id_2);
+        const char* error = nullptr;
+        vector<IndividualImage> images;
+        if (!first_members || !second || !member_ids) {
+            error = "group not found";
+        } else if (first_members->size() + member_ids->size() > Group::MAX_MEMBERS) {
+            error = "the merged group would exceed the member limit"; // Shards never share an individual
+        } else if (member_ids->empty()) {
+            error = "an empty group cannot change shards";
+        } else {
+            for (int member_id : *member_ids) {
+                optional<IndividualImage> image = source.export_individual(member_id);
+                if (!image) break;
+                images.push_back(std::move(*image));
+            }
+            if (images.size() < member_ids->size()) error = "a member could not be exported";
+        }
+        if (error) {
+            _say("Error: Could not merge group ", merge.group_id_2, " into ", merge.group_id_1, " (", error, ").");
+            return false;
+        }
+
+        vector<int> imported;
+        for (const IndividualImage& image : images) {
+            if (!target.import_individual(image)) break;
+            imported.push_back(image.id);
+        }
+        if (imported.size() < images.size()) {
+            error = "a member could not be copied to the target shard";
+        } else if (!target.create_group(merge.group_id_2, second->group_name, imported, second->weekly_group_goal)) {
+            error = "the group could not be created on the target shard";
+        } else if (!target.merge_groups(merge.group_id_1, merge.group_id_2, merge.new_group_name, merge.new_weekly_goal)) {
+            target.delete_group(merge.group_id_2);
+            error = "the groups could not be merged";
+        }
+        if (error) {
+            target.delete_individuals(imported); // Group 2 and its members are still intact on the source
+            _say("Error: Could not merge group ", merge.group_id_2, " into ", merge.group_id_1, " (", error, ").");
+            return false;
+        }
+
+        for (int member_id : imported) home[member_id] = static_cast<uint32_t>(target_shard);
+        if (!source.delete_group(merge.group_id_2) || source.delete_individuals(imported) < imported.size()) {
+            _say("Warning: Group ", merge.group_id_2, " was merged, but its original could not be fully removed from shard ",
+                 source_shard, ".");
+        }
+        return true;
+    }
+
+    // Merges per-shard lists, each already in rank order, into the first k entries of the
+    // global order (ahead(a, b) when a ranks before b) and renumbers their ranks. The lists
+    // may be shared with the shards' query caches, so their entries are copied.
+    template <typename Entry, typename Ahead>
+    static vector<Entry> _merge_ranked(const vector<const vector<Entry>*>& lists, size_t k, Ahead ahead) {
+        vector<pair<size_t, size_t>> heads; // (list, position), a heap with the best head on top
+        for (size_t i = 0; i < lists.size(); ++i) {
+            if (!lists[i]->empty()) heads.emplace_back(i, 0);
+        }
+        auto behind = [&](const pair<size_t, size_t>& a, const pair<size_t, size_t>& b) {
+            return ahead((*lists[b.first])[b.second], (*lists[a.first])[a.second]);
+        };
+        make_heap(heads.begin(), heads.end(), behind);
+        vector<Entry> merged;
+        while (!heads.empty() && merged.size() < k) {
+            pop_heap(heads.begin(), heads.end(), behind);
+            auto& [list, position] = heads.back();
+            merged.push_back((*lists[list])[position]);
+            merged.back().rank = merged.size();
+            if (++position < lists[list]->size()) {
+                push_heap(heads.begin(), heads.end(), behind);
+            } else {
+                heads.pop_back();
+            }
+        }
+        return merged;
+    }
+
+public:
+    // Opens (or creates) every shard's files in parallel: a shard loads its snapshot if it
+    // has one, otherwise its CSV files (see partition_csv()). All shards are brought to the
+    // latest day among them.
+    explicit ShardedStepTracker(ShardLayout shard_layout, JournalPolicy journal_policy = JournalPolicy())
+        : layout(std::move(shard_layout)), scatter_pool(static_cast<unsigned>(layout.shard_count())) {
+        sort(layout.split_points.begin(), layout.split_points.end(),
+             [](const string& a, const string& b) { return GroupKey(a) < GroupKey(b); });
+        split_keys = _split_keys(layout);
+        shards.resize(layout.shard_count());
+        scatter_pool.parallel_for(shards.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                shards[i] = make_unique<StepTrackerApp>(layout.file(i, "individuals.csv"), layout.file(i, "groups.csv"),
+                                                        layout.file(i, "journal"), journal_policy,
+                                                        layout.file(i, "snapshot"));
+                shards[i]->set_thread_count(1); // Parallelism comes from the shards themselves
+            }
+        });
+        _build_directory();
+        int latest = 0;
+        for (const auto& shard : shards) latest = max(latest, shard->current_day());
+        _for_each_shard([&](size_t, StepTrackerApp& shard) { shard.advance_to_day(latest); });
+        day_number = latest;
+    }
+
+    // Splits one pair of individuals and groups CSV files into per-shard CSV files for the
+    // given layout: each group goes to the shard of its ID range along with its members, and
+    // un-grouped individuals are spread by ID. Any shard journals and snapshots are removed,
+    // so the next ShardedStepTracker imports the new files. Rows are copied as they are;
+    // the shards report malformed ones when they load.
+    static bool partition_csv(const string& individuals_file, const string& groups_file, const ShardLayout& layout) {
+        CsvBlockReader individuals_in(individuals_file);
+        CsvBlockReader groups_in(groups_file);
+        if (!individuals_in.is_open() && !groups_in.is_open()) {
+            cerr << "Error: Neither CSV file '" << individuals_file << "' nor '" << groups_file << "' exists." << endl;
+            return false;
+        }
+        vector<string> split_points = layout.split_points;
+        sort(split_points.begin(), split_points.end(),
+             [](const string& a, const string& b) { return GroupKey(a) < GroupKey(b); });
+        vector<GroupKey> split_keys(split_points.begin(), split_points.end());
+        size_t shard_count = layout.shard_count();
+
+        vector<ofstream> individuals_out(shard_count), groups_out(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            individuals_out[i].open(layout.file(i, "individuals.csv"));
+            groups_out[i].open(layout.file(i, "groups.csv"));
+            if (!individuals_out[i].is_open() || !groups_out[i].is_open()) {
+                cerr << "Error: Could not create the CSV files for shard " << i << "." << endl;
+                return false;
+            }
+            groups_out[i] << GROUPS_CSV_HEADER << '\n';
+            remove(layout.file(i, "journal").c_str());
+            remove(layout.file(i, "snapshot").c_str());
+        }
+
+        unordered_map<int, size_t> member_shard;
+        string_view line;
+        bool header = true;
+        while (groups_in.is_open() && groups_in.next_line(line)) {
+            if (header) {
+                header = false;
+                continue;
+            }
+            if (line.empty()) continue;
+            CsvFieldCursor fields(line);
+            string_view id_field, name_field, members_field, member_field;
+            fields.next(id_field);
+            size_t shard = _shard_of_group(split_keys, id_field);
+            if (fields.next(name_field) && fields.next(members_field)) {
+                CsvFieldCursor members(members_field);
+                int member_id;
+                while (members.next(member_field, ';')) {
+                    if (parse_csv_int(member_field, member_id)) member_shard.emplace(member_id, shard);
+                }
+            }
+            groups_out[shard] << line << '\n';
+        }
+
+        header = true;
+        while (individuals_in.is_open() && individuals_in.next_line(line)) {
+            if (header) { // Kept as it is: it tells whether the rows have a Points column
+                for (ofstream& out : individuals_out) out << line << '\n';
+                header = false;
+                continue;
+            }
+            if (line.empty()) continue;
+            CsvFieldCursor fields(line);
+            string_view id_field;
+            int individual_id = 0;
+            fields.next(id_field);
+            size_t shard = 0;
+            if (parse_csv_int(id_field, individual_id)) {
+                auto it = member_shard.find(individual_id);
+                shard = it != member_shard.end() ? it->second : static_cast<uint32_t>(individual_id) % shard_count;
+            }
+            individuals_out[shard] << line << '\n';
+        }
+        if (header) { // No individuals file
+            for (ofstream& out : individuals_out) out << INDIVIDUALS_CSV_HEADER << '\n';
+        }
+        for (size_t i = 0; i < shard_count; ++i) {
+            if (!individuals_out[i].flush() || !groups_out[i].flush()) {
+                cerr << "Error: Could not write the CSV files for shard " << i << "." << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t shard_count() const { return shards.size(); }
+    const ShardLayout& shard_layout() const { return layout; }
+
+    // Direct access to one shard, for per-shard reports. Individuals must not be added or
+    // deleted through it, or the router's directory goes stale.
+    StepTrackerApp& shard(size_t index) { return *shards[index]; }
+
+    // The shard that holds (or would hold) the given group.
+    size_t shard_of_group(const string& group_id) const { return _shard_of_group(group_id); }
+
+    void set_output_format(OutputFormat format) {
+        output_format.store(format, memory_order_relaxed);
+        for (const auto& shard : shards) shard->set_output_format(format);
+    }
+
+    // Bounds each shard's query cache (see StepTrackerApp::set_query_cache_capacity()).
+    void set_query_cache_capacity(size_t rows) {
+        for (const auto& shard : shards) shard->set_query_cache_capacity(rows);
+    }
+
+    void flush() {
+        _for_each_shard([](size_t, StepTrackerApp& shard) { shard.flush(); });
+    }
+
+    // Durability fence over every shard (see StepTrackerApp::wait_durable()).
+    bool wait_durable() {
+        atomic<bool> ok{true};
+        _for_each_shard([&](size_t, StepTrackerApp& shard) {
+            if (!shard.wait_durable()) ok.store(false, memory_order_relaxed);
+        });
+        return ok.load();
+    }
+
+    // Compacts every shard's journal into its snapshot. Returns false if any shard failed.
+    bool compact() {
+        atomic<bool> ok{true};
+        _for_each_shard([&](size_t, StepTrackerApp& shard) {
+            if (!shard.compact()) ok.store(false, memory_order_relaxed);
+        });
+        return ok.load();
+    }
+
+    // Writes every shard's CSV files. Returns false if any shard failed.
+    bool export_csv() const {
+        atomic<bool> ok{true};
+        _for_each_shard([&](size_t, StepTrackerApp& shard) {
+            if (!shard.export_csv()) ok.store(false, memory_order_relaxed);
+        });
+        return ok.load();
+    }
+
+    bool add_person(int id, const string& name, int age, int daily_step_goal, const vector<int>& weekly_step_count) {
+        WriteLock lock(directory_mutex);
+        size_t shard = _shard_of_individual(id); // An existing ID is refused by its own shard
+        if (!shards[shard]->add_person(id, name, age, daily_step_goal, weekly_step_count)) return false;
+        home.emplace(id, static_cast<uint32_t>(shard));
+        return true;
+    }
+
+    // Creates the group on the shard of its ID range, first moving any un-grouped members
+    // there from other shards. Members grouped elsewhere are skipped as not found.
+    bool create_group(const string& group_id, const string& group_name, const vector<int>& member_ids, int weekly_group_goal) {
+        WriteLock lock(directory_mutex);
+        size_t target = _shard_of_group(group_id);
+        StepTrackerApp& shard = *shards[target];
+        if (member_ids.size() <= Group::MAX_MEMBERS && !shard.group_achievement(group_id)) { // Would not be refused
+            for (int member_id : member_ids) _move_individual(member_id, target);
+        }
+        return shard.create_group(group_id, group_name, member_ids, weekly_group_goal);
+    }
+
+    bool delete_individual(int individual_id) {
+        WriteLock lock(directory_mutex);
+        if (!shards[_shard_of_individual(individual_id)]->delete_individual(individual_id)) return false;
+        home.erase(individual_id);
+        return true;
+    }
+
+    // Deletes the individuals shard by shard in parallel. Returns how many were deleted.
+    size_t delete_individuals(const vector<int>& individual_ids) {
+        WriteLock lock(directory_mutex);
+        vector<vector<int>> by_shard(shards.size());
+        for (int individual_id : individual_ids) {
+            auto it = home.find(individual_id);
+            if (it != home.end()) by_shard[it->second].push_back(individual_id);
+        }
+        atomic<size_t> deleted{0};
+        _for_each_shard([&](size_t i, StepTrackerApp& shard) {
+            if (!by_shard[i].empty()) deleted.fetch_add(shard.delete_individuals(by_shard[i]), memory_order_relaxed);
+        });
+        for (const vector<int>& ids : by_shard) {
+            for (int individual_id : ids) home.erase(individual_id);
+        }
+        return deleted.load();
+    }
+
+    bool delete_group(const string& group_id) {
+        ReadLock lock(directory_mutex);
+        return shards[_shard_of_group(group_id)]->delete_group(group_id);
+    }
+
+    // Merges group 2 into group 1 on group 1's shard; see _merge_across_shards() for groups
+    // on different shards.
+    bool merge_groups(const string& group_id_1, const string& group_id_2, const string& new_group_name, int new_weekly_goal) {
+        size_t target = _shard_of_group(group_id_1), source = _shard_of_group(group_id_2);
+        if (target == source) {
+            ReadLock lock(directory_mutex);
+            return shards[target]->merge_groups(group_id_1, group_id_2, new_group_name, new_weekly_goal);
+        }
+        WriteLock lock(directory_mutex);
+        return _merge_across_shards(target, source, GroupMerge{group_id_1, group_id_2, new_group_name, new_weekly_goal});
+    }
+
+    // Applies the merges in order. Runs of same-shard merges are applied by all shards in
+    // parallel, one batch each; a cross-shard merge waits for the run before it. Returns
+    // how many were merged.
+    size_t merge_groups_many(const vector<GroupMerge>& merges) {
+        WriteLock lock(directory_mutex);
+        size_t merged = 0;
+        vector<vector<GroupMerge>> by_shard(shards.size());
+        auto flush = [&] {
+            atomic<size_t> count{0};
+            _for_each_shard([&](size_t i, StepTrackerApp& shard) {
+                if (!by_shard[i].empty()) count.fetch_add(shard.merge_groups_many(by_shard[i]), memory_order_relaxed);
+            });
+            for (vector<GroupMerge>& batch : by_shard) batch.clear();
+            merged += count.load();
+        };
+        for (const GroupMerge& merge : merges) {
+            size_t target = _shard_of_group(merge.group_id_1), source = _shard_of_group(merge.group_id_2);
+            if (target == source) {
+                by_shard[target].push_back(merge);
+            } else {
+                flush();
+                merged += _merge_across_shards(target, source, merge);
+            }
+        }
+        flush();
+        return merged;
+    }
+
+    bool record_steps(int individual_id, int day, int steps) {
+        {
+            ReadLock lock(directory_mutex);
+            if (day <= day_number) return shards[_shard_of_individual(individual_id)]->record_steps(individual_id, day, steps);
+        }
+        WriteLock lock(directory_mutex); // A new day: every shard rolls over first
+        _advance_to_day(day);
+        return shards[_shard_of_individual(individual_id)]->record_steps(individual_id, day, steps);
+    }
+
+    // Routes the reports to their shards, which apply them in parallel (in order within each
+    // shard). Returns how many were recorded.
+    size_t record_steps_batch(const vector<StepRecord>& records) {
+        int latest = 0;
+        for (const StepRecord& record : records) latest = max(latest, record.day);
+        if (latest > current_day()) { // A new day: every shard rolls over first
+            WriteLock lock(directory_mutex);
+            _advance_to_day(latest);
+        }
+        ReadLock lock(directory_mutex);
+        vector<vector<StepRecord>> by_shard(shards.size());
+        for (const StepRecord& record : records) by_shard[_shard_of_individual(record.individual_id)].push_back(record);
+        atomic<size_t> recorded{0};
+        _for_each_shard([&](size_t i, StepTrackerApp& shard) {
+            if (!by_shard[i].empty()) recorded.fetch_add(shard.record_steps_batch(by_shard[i]), memory_order_relaxed);
+        });
+        return recorded.load();
+    }
+
+    void advance_to_day(int day) {
+        WriteLock lock(directory_mutex);
+        _advance_to_day(day);
+    }
+
+    int current_day() const {
+        ReadLock lock(directory_mutex);
+        return day_number;
+    }
+
+    optional<StepWindowStats> step_history(int individual_id, int first_day, int last_day) const {
+        ReadLock lock(directory_mutex);
+        return shards[_shard_of_individual(individual_id)]->step_history(individual_id, first_day, last_day);
+    }
+
+    optional<StepWindowStats> group_step_history(const string& group_id, int first_day, int last_day) const {
+        ReadLock lock(directory_mutex);
+        return shards[_shard_of_group(group_id)]->group_step_history(group_id, first_day, last_day);
+    }
+
+    optional<GroupAchievement> group_achievement(const string& group_id) {
+        ReadLock lock(directory_mutex);
+        return shards[_shard_of_group(group_id)]->group_achievement(group_id);
+    }
+
+    // The group's 1-based rank on the global leaderboard, or 0 if it does not exist: one plus
+    // the groups ranked ahead of it on every shard. Each shard answers at its own moment.
+    size_t group_rank(const string& group_id) {
+        ReadLock lock(directory_mutex);
+        optional<GroupAchievement> group = shards[_shard_of_group(group_id)]->group_achievement(group_id);
+        if (!group) return 0;
+        atomic<size_t> ahead{0};
+        _for_each_shard([&](size_t, StepTrackerApp& shard) {
+            ahead.fetch_add(shard.groups_ranked_ahead(group->total_weekly_steps, group_id), memory_order_relaxed);
+        });
+        return ahead.load() + 1;
+    }
+
+    // The k highest-ranked groups across all shards: each shard's top k, merged.
+    LeaderboardResult leader_board(size_t k = SIZE_MAX) {
+        ReadLock lock(directory_mutex);
+        vector<LeaderboardResult> results(shards.size());
+        _for_each_shard([&](size_t i, StepTrackerApp& shard) { results[i] = shard.leader_board(k); });
+        vector<const vector<LeaderboardEntry>*> lists;
+        for (const LeaderboardResult& result : results) lists.push_back(result.get());
+        return make_shared<const vector<LeaderboardEntry>>(
+            _merge_ranked(lists, k, [](const LeaderboardEntry& a, const LeaderboardEntry& b) {
+                if (a.total_weekly_steps != b.total_weekly_steps) return a.total_weekly_steps > b.total_weekly_steps;
+                return GroupKey(a.group_id) < GroupKey(b.group_id);
+            }));
+    }
+
+    // Today's k best goal achievers across all shards: each shard's top k, merged.
+    vector<DailyRankEntry> daily_leaders(size_t k) {
+        ReadLock lock(directory_mutex);
+        vector<vector<DailyRankEntry>> results(shards.size());
+        _for_each_shard([&](size_t i, StepTrackerApp& shard) { results[i] = shard.daily_leaders(k); });
+        vector<const vector<DailyRankEntry>*> lists;
+        for (const vector<DailyRankEntry>& result : results) lists.push_back(&result);
+        return _merge_ranked(lists, k, [](const DailyRankEntry& a, const DailyRankEntry& b) {
+            if (a.steps != b.steps) return a.steps > b.steps;
+            return a.individual_id < b.individual_id;
+        });
+    }
+
+    // Groups with IDs in [start_group_id, end_group_id], gathered from the shards whose
+    // ranges overlap it and ranked by total weekly steps within the range.
+    GroupRangeResult group_range_info(const string& start_group_id, const string& end_group_id) {
+        ReadLock lock(directory_mutex);
+        size_t first = _shard_of_group(start_group_id), last = _shard_of_group(end_group_id);
+        if (last < first) return make_shared<const vector<GroupRangeEntry>>();
+        vector<GroupRangeResult> results(last - first + 1);
+        scatter_pool.parallel_for(results.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) results[i] = shards[first + i]->group_range_info(start_group_id, end_group_id);
+        });
+        if (results.size() == 1) return results[0]; // One shard's result is already ranked within the range
+        vector<const vector<GroupRangeEntry>*> lists;
+        for (const GroupRangeResult& result : results) lists.push_back(result.get());
+        return make_shared<const vector<GroupRangeEntry>>(
+            _merge_ranked(lists, SIZE_MAX, [](const GroupRangeEntry& a, const GroupRangeEntry& b) {
+                if (a.total_weekly_steps != b.total_weekly_steps) return a.total_weekly_steps > b.total_weekly_steps;
+                return GroupKey(a.group_id) < GroupKey(b.group_id);
+            }));
+    }
+
+    // Population-wide totals, summed over the shards.
+    PopulationSummary population_summary() const {
+        ReadLock lock(directory_mutex);
+        vector<PopulationSummary> parts(shards.size());
+        _for_each_shard([&](size_t i, StepTrackerApp& shard) { parts[i] = shard.population_summary(); });
+        PopulationSummary summary;
+        for (const PopulationSummary& part : parts) {
+            summary.individuals += part.individuals;
+            summary.individual_steps += part.individual_steps;
+            summary.goal_days += part.goal_days;
+            summary.daily_achievers += part.daily_achievers;
+            summary.groups += part.groups;
+            summary.group_steps += part.group_steps;
+            summary.groups_at_goal += part.groups_at_goal;
+        }
+        return summary;
+    }
+};
+
+#endif // STEP_TRACKER_H